@@ -0,0 +1,130 @@
+#include "AdaptiveConcurrency.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace filetimefixer {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<AdaptiveConcurrency*> g_observer{ nullptr };
+
+double p90(std::vector<double>& samples) {
+    size_t k = samples.size() * 9 / 10;
+    if (k >= samples.size()) k = samples.size() - 1;
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(k), samples.end());
+    return samples[k];
+}
+
+}  // namespace
+
+const char* ioStageName(IoStage stage) {
+    switch (stage) {
+    case IoStage::MetadataRead: return "metadata read";
+    case IoStage::Rename: return "rename";
+    case IoStage::MetadataWrite: return "metadata write";
+    case IoStage::FileTime: return "utime";
+    default: return "?";
+    }
+}
+
+AdaptiveConcurrency::AdaptiveConcurrency(const AdaptiveOptions& options,
+                                         std::function<void(const std::string&)> onChange)
+    : options_(options), onChange_(std::move(onChange)) {
+    options_.minJobs = std::max(1u, options_.minJobs);
+    options_.maxJobs = std::max(options_.minJobs, options_.maxJobs);
+    limit_ = std::clamp(options_.initialJobs, options_.minJobs, options_.maxJobs);
+    lowest_ = highest_ = limit_;
+    windowStart_ = Clock::now();
+}
+
+AdaptiveConcurrency::~AdaptiveConcurrency() {
+    AdaptiveConcurrency* self = this;
+    g_observer.compare_exchange_strong(self, nullptr);
+}
+
+void AdaptiveConcurrency::acquire() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    slotCv_.wait(lk, [this] { return inFlight_ < limit_; });
+    ++inFlight_;
+    if (inFlight_ >= limit_) saturated_ = true;
+}
+
+void AdaptiveConcurrency::release() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        --inFlight_;
+        auto now = Clock::now();
+        if (now - windowStart_ >= options_.window) decideLocked(now);
+    }
+    slotCv_.notify_all();
+}
+
+void AdaptiveConcurrency::recordLatency(IoStage stage, Clock::duration latency) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    samplesMs_[static_cast<int>(stage)].push_back(std::chrono::duration<double, std::milli>(latency).count());
+}
+
+unsigned AdaptiveConcurrency::limit() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return limit_;
+}
+
+std::string AdaptiveConcurrency::describe() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return "final " + std::to_string(limit_) + ", range " + std::to_string(lowest_) + "-"
+        + std::to_string(highest_) + ", " + std::to_string(changes_) + " changes";
+}
+
+void AdaptiveConcurrency::decideLocked(Clock::time_point now) {
+    const double targetMs = static_cast<double>(options_.targetLatency.count());
+    int worst = -1;
+    double worstMs = 0;
+    for (int s = 0; s < static_cast<int>(IoStage::Count); ++s) {
+        if (samplesMs_[s].empty()) continue;
+        double ms = p90(samplesMs_[s]);
+        if (worst < 0 || ms > worstMs) {
+            worst = s;
+            worstMs = ms;
+        }
+    }
+    if (worst < 0) return;  // Nothing measured yet: keep the window open
+
+    unsigned next = limit_;
+    char reason[160];
+    const char* stageName = ioStageName(static_cast<IoStage>(worst));
+    if (worstMs > targetMs) {
+        next = std::max(options_.minJobs, static_cast<unsigned>(limit_ * 0.7));
+        std::snprintf(reason, sizeof(reason), "%s p90 %.0f ms > target %.0f ms", stageName, worstMs, targetMs);
+    } else if (saturated_) {
+        next = std::min(options_.maxJobs, limit_ + 1);
+        std::snprintf(reason, sizeof(reason), "all stages under target %.0f ms (worst %s p90 %.0f ms)",
+                      targetMs, stageName, worstMs);
+    }
+    if (next != limit_) {
+        std::string line = "[Adaptive] jobs " + std::to_string(limit_) + " -> " + std::to_string(next) + ": " + reason;
+        limit_ = next;
+        lowest_ = std::min(lowest_, limit_);
+        highest_ = std::max(highest_, limit_);
+        ++changes_;
+        if (onChange_) onChange_(line);
+    }
+    for (auto& samples : samplesMs_) samples.clear();
+    saturated_ = inFlight_ >= limit_;
+    windowStart_ = now;
+}
+
+StageTimer::StageTimer(IoStage stage) : stage_(stage), start_(Clock::now()) {}
+
+StageTimer::~StageTimer() {
+    if (AdaptiveConcurrency* observer = g_observer.load(std::memory_order_relaxed))
+        observer->recordLatency(stage_, Clock::now() - start_);
+}
+
+void setStageLatencyObserver(AdaptiveConcurrency* controller) {
+    g_observer = controller;
+}
+
+}  // namespace filetimefixer
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace filetimefixer {
+
+// Per-file steps whose latency tells how loaded the storage is: the image EXIF read / write, the
+// rename and the utime. Video metadata goes through ffprobe / ffmpeg processes whose run time is
+// mostly process start and remuxing, so it is not sampled.
+enum class IoStage { MetadataRead, Rename, MetadataWrite, FileTime, Count };
+
+const char* ioStageName(IoStage stage);
+
+struct AdaptiveOptions {
+    std::chrono::milliseconds targetLatency{ 250 };  // p90 any stage may reach before backing off
+    unsigned minJobs = 1;
+    unsigned maxJobs = 16;
+    unsigned initialJobs = 2;
+    std::chrono::milliseconds window{ 1000 };  // Minimum time between two decisions
+};
+
+/// AIMD controller for the number of files in flight (--adaptive). Workers call acquire() before a
+/// file and release() after it; stage latencies arrive through StageTimer. Once per window, if the
+/// p90 latency of any stage is above target the limit is cut by 30% (multiplicative decrease);
+/// if every stage is under target and the limit was actually reached, it grows by one (additive
+/// increase). Each change is reported through onChange with its reason.
+class AdaptiveConcurrency {
+public:
+    AdaptiveConcurrency(const AdaptiveOptions& options, std::function<void(const std::string&)> onChange);
+    ~AdaptiveConcurrency();
+
+    void acquire();
+    void release();
+    void recordLatency(IoStage stage, std::chrono::steady_clock::duration latency);
+
+    unsigned limit() const;
+    /// "final 6, range 2-9, 14 changes"
+    std::string describe() const;
+
+private:
+    void decideLocked(std::chrono::steady_clock::time_point now);
+
+    AdaptiveOptions options_;
+    std::function<void(const std::string&)> onChange_;
+    mutable std::mutex mutex_;
+    std::condition_variable slotCv_;
+    unsigned limit_;
+    unsigned inFlight_ = 0;
+    bool saturated_ = false;  // inFlight reached limit during the current window
+    std::vector<double> samplesMs_[static_cast<int>(IoStage::Count)];
+    std::chrono::steady_clock::time_point windowStart_;
+    unsigned lowest_, highest_, changes_ = 0;
+};
+
+/// Times one stage and reports it to the controller installed for this run (no-op when none is).
+class StageTimer {
+public:
+    explicit StageTimer(IoStage stage);
+    ~StageTimer();
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    IoStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// Install (or with nullptr remove) the controller that receives StageTimer samples.
+void setStageLatencyObserver(AdaptiveConcurrency* controller);
+
+}  // namespace filetimefixer
@@ -0,0 +1,345 @@
+// FileTimeFixerBench: ns/op of the time pipeline (filename parse, EXIF / UTC string parse, name and
+// EXIF formatting, target time resolution), as Google Benchmark style JSON on stdout so results can
+// be kept per release and compared. Inputs are the cases of test_spec/*.yaml plus synthetic names.
+//
+//   FileTimeFixerBench [--names N] [--spec DIR] [--min-time S] [--filter TEXT] [--out FILE]
+
+#include "TimeParse.h"
+#include "TimeConvert.h"
+#include "TargetTimeResolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef FILETIMEFIXER_TEST_SPEC_DIR
+#define FILETIMEFIXER_TEST_SPEC_DIR "../test_spec"
+#endif
+
+namespace fs = std::filesystem;
+using filetimefixer::FileNameTime;
+using filetimefixer::TimeValue;
+
+namespace {
+
+struct BenchOptions {
+    size_t syntheticNames = 2000000;
+    fs::path specDir = FILETIMEFIXER_TEST_SPEC_DIR;
+    double minSeconds = 0.5;  // Per benchmark; whole passes over the inputs until at least this long
+    std::string filter;
+    std::string outPath;
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double realNs = 0;  // Per op
+    double cpuNs = 0;
+};
+
+// Values of "key: value" lines (optionally "- key: value", value optionally quoted) in a YAML spec.
+// Enough for test_spec/*.yaml, which are flat lists of string cases.
+std::vector<std::string> readSpecValues(const fs::path& path, std::string_view key) {
+    std::vector<std::string> values;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string_view s(line);
+        size_t start = s.find_first_not_of(" \t-");
+        if (start == std::string_view::npos || s[start] == '#') continue;
+        s.remove_prefix(start);
+        if (s.substr(0, key.size()) != key || s.substr(key.size(), 1) != ":") continue;
+        s.remove_prefix(key.size() + 1);
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\r')) s.remove_suffix(1);
+        if (s.size() >= 2 && s.front() == '"' && s.back() == '"') s = s.substr(1, s.size() - 2);
+        values.emplace_back(s);
+    }
+    return values;
+}
+
+// Deterministic names in the shapes seen in camera rolls and chat exports, plus near misses
+// (invalid dates, short runs) so the rejection paths are timed too
+std::vector<std::string> makeSyntheticNames(size_t count) {
+    uint32_t seed = 20240807;
+    auto next = [&seed](uint32_t n) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % n;
+    };
+    auto digits = [&next](size_t n) {
+        std::string d;
+        for (size_t k = 0; k < n; ++k) d += static_cast<char>('0' + next(10));
+        return d;
+    };
+    auto two = [&next](uint32_t limit) {
+        uint32_t v = next(limit);
+        return std::string{ static_cast<char>('0' + v / 10), static_cast<char>('0' + v % 10) };
+    };
+    auto date8 = [&]() { return "20" + two(26) + two(13) + two(31); };
+    const std::vector<std::function<std::string()>> shapes = {
+        [&]() { return "IMG_" + date8() + "_" + two(24) + two(60) + two(60) + ".jpg"; },
+        [&]() { return "VID_" + date8() + "_" + two(24) + two(60) + two(60) + ".mp4"; },
+        [&]() { return "MEITU_" + date8() + "_" + two(24) + two(60) + two(60) + digits(3) + ".jpg"; },
+        [&]() { return "pt20" + two(26) + "_" + two(13) + "_" + two(29) + "_" + two(24) + "_" + two(60) + "_" + two(60) + ".jpg"; },
+        [&]() { return "Screenshot_20" + two(26) + "-" + two(13) + "-" + two(29) + "-" + two(24) + "-" + two(60) + "-"
+                       + two(60) + "-" + digits(3) + "_com.tencent.mm.jpg"; },
+        [&]() { return date8() + "-wczt.jpg"; },
+        [&]() { return "mmexport1" + digits(12) + ".jpg"; },
+        [&]() { return "wx_camera_1" + digits(12) + ".jpg"; },
+        [&]() { return "1" + digits(9) + ".jpeg"; },
+        [&]() { return "DSC_" + digits(4) + ".JPG"; },
+        [&]() { return "holiday photo " + digits(2) + " (copy).png"; },
+    };
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i) names.push_back(shapes[next(static_cast<uint32_t>(shapes.size()))]());
+    return names;
+}
+
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& options) : options_(options) {}
+
+    // body(i) runs on input i of count and does opsPerCall ops (names of a batch); it returns
+    // something derived from the result so the work cannot be optimized away
+    template <typename Body>
+    void run(const std::string& name, size_t count, Body body, size_t opsPerCall = 1) {
+        if (count == 0 || (!options_.filter.empty() && name.find(options_.filter) == std::string::npos)) return;
+        using Clock = std::chrono::steady_clock;
+        uint64_t sink = 0;
+        for (size_t i = 0; i < std::min<size_t>(count, 1024); ++i) sink += body(i);  // Warm up
+        uint64_t iterations = 0;
+        std::clock_t cpuStart = std::clock();
+        Clock::time_point start = Clock::now();
+        double elapsed = 0;
+        do {
+            for (size_t i = 0; i < count; ++i) sink += body(i);
+            iterations += count * opsPerCall;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < options_.minSeconds);
+        double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        sink_ += sink;
+        BenchResult r{ name, iterations, elapsed * 1e9 / iterations, cpu * 1e9 / iterations };
+        std::fprintf(stderr, "%-40s %12.1f ns/op %14llu ops\n", name.c_str(), r.realNs,
+                     static_cast<unsigned long long>(iterations));
+        results_.push_back(r);
+    }
+
+    void writeJson(std::ostream& out, const std::string& executable) const {
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::gmtime(&now));
+        out << "{\n  \"context\": {\n"
+            << "    \"date\": \"" << date << "Z\",\n"
+            << "    \"executable\": \"" << jsonEscape(executable) << "\",\n"
+            << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"synthetic_names\": " << options_.syntheticNames << ",\n"
+            << "    \"spec_dir\": \"" << jsonEscape(options_.specDir.generic_string()) << "\",\n"
+            << "    \"filename_batch_isa\": \"" << filetimefixer::fileNameBatchIsa() << "\",\n"
+#ifdef NDEBUG
+            << "    \"library_build_type\": \"release\",\n"
+#else
+            << "    \"library_build_type\": \"debug\",\n"
+#endif
+            << "    \"checksum\": " << sink_ << "\n  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            char times[96];
+            std::snprintf(times, sizeof(times), "\"real_time\": %.3f, \"cpu_time\": %.3f", r.realNs, r.cpuNs);
+            out << (i ? ",\n" : "\n") << "    { \"name\": \"" << jsonEscape(r.name)
+                << "\", \"run_type\": \"iteration\", \"iterations\": " << r.iterations << ", " << times
+                << ", \"time_unit\": \"ns\", \"items_per_second\": " << static_cast<uint64_t>(1e9 / r.realNs) << " }";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    static std::string jsonEscape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) out += c;
+        }
+        return out;
+    }
+
+    const BenchOptions& options_;
+    std::vector<BenchResult> results_;
+    uint64_t sink_ = 0;
+};
+
+// parseUTCStringToTm as it was before the fixed-layout parser: up to three istringstream + get_time
+// attempts. Kept only as the baseline of parseUTCStringToTm/stream_reference.
+bool streamParseUTCStringToTm(std::tm& tm, const std::string& utcTimeStr) {
+    std::istringstream ss(utcTimeStr);
+    if (utcTimeStr.empty()) return false;
+    if (utcTimeStr.find('T') != std::string::npos && utcTimeStr.find('-') != std::string::npos) {
+        ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+        if (!ss.fail()) return true;
+    }
+    if (utcTimeStr.find('-') != std::string::npos) {
+        ss.clear();
+        ss.str(utcTimeStr);
+        ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+        if (!ss.fail()) return true;
+    }
+    if (utcTimeStr.find(':') != std::string::npos) {
+        ss.clear();
+        ss.str(utcTimeStr);
+        ss >> std::get_time(&tm, "%Y:%m:%d %H:%M:%S");
+        if (!ss.fail()) return true;
+    }
+    return false;
+}
+
+uint64_t fieldsChecksum(const FileNameTime& t) {
+    return static_cast<uint64_t>(t.year * 372 + t.month * 31 + t.day) ^ static_cast<uint64_t>(t.second + t.millis);
+}
+
+bool parseArgs(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << arg << " requires a value" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--names") {
+            options.syntheticNames = std::stoull(value);
+        } else if (arg == "--spec") {
+            options.specDir = value;
+        } else if (arg == "--min-time") {
+            options.minSeconds = std::stod(value);
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: FileTimeFixerBench [--names N] [--spec DIR] [--min-time SECONDS] [--filter TEXT]"
+                     " [--out FILE]\n"
+                     "  --names N        Synthetic filenames (default 2000000)\n"
+                     "  --spec DIR       test_spec directory with time_parse.yaml / target_resolver.yaml\n"
+                     "  --min-time S     Minimum time per benchmark (default 0.5)\n"
+                     "  --filter TEXT    Only benchmarks whose name contains TEXT\n"
+                     "  --out FILE       Write the JSON there instead of stdout\n";
+        return 1;
+    }
+    const auto& zone = filetimefixer::localTimeZone();
+
+    // test_spec cases
+    std::vector<std::string> specNames = readSpecValues(options.specDir / "time_parse.yaml", "filename");
+    std::vector<std::string> specNameTimes = readSpecValues(options.specDir / "target_resolver.yaml", "name_time");
+    std::vector<std::string> specExifTimes = readSpecValues(options.specDir / "target_resolver.yaml", "exif_time");
+    if (specNames.empty() || specNameTimes.empty())
+        std::cerr << "Warning: no cases read from " << options.specDir.string() << "; synthetic inputs only" << std::endl;
+    std::vector<std::pair<TimeValue, TimeValue>> specPairs;
+    for (size_t i = 0; i < std::min(specNameTimes.size(), specExifTimes.size()); ++i)
+        specPairs.emplace_back(filetimefixer::parseTimeValue(specNameTimes[i], zone),
+                               filetimefixer::parseTimeValue(specExifTimes[i], 0));
+
+    // Synthetic inputs: the names, the times found in them, and EXIF / UTC strings and
+    // (name, EXIF) pairs derived from those times
+    std::vector<std::string> names = makeSyntheticNames(options.syntheticNames);
+    std::vector<std::string_view> views(names.begin(), names.end());
+    std::vector<TimeValue> values;
+    std::vector<std::string> exifStrings, utcStrings;
+    std::vector<std::pair<TimeValue, TimeValue>> pairs;
+    for (const std::string& name : names) {
+        FileNameTime t;
+        if (!filetimefixer::scanFileNameTime(name, t)) continue;
+        TimeValue value = filetimefixer::timeValueFromWall(t, zone);
+        if (value.empty()) continue;
+        char buf[filetimefixer::kIsoTimeLength];
+        values.push_back(value);
+        exifStrings.emplace_back(buf, filetimefixer::formatTimeForExif(value, buf));
+        utcStrings.emplace_back(buf, filetimefixer::formatUtcIsoTime(value.epochSeconds(), buf));
+        TimeValue exif = value;
+        exif.epochMs += static_cast<int64_t>(values.size() % 7) * 3600000 - 10800000;
+        exif.precision = filetimefixer::TimePrecision::Seconds;
+        exif.offsetMinutes = 0;
+        pairs.emplace_back(value, exif);
+    }
+    for (const std::string& s : specExifTimes)
+        if (!s.empty()) utcStrings.push_back(s);
+    std::fprintf(stderr, "%zu spec names, %zu spec pairs, %zu synthetic names (%zu with a time)\n",
+                 specNames.size(), specPairs.size(), names.size(), values.size());
+
+    BenchRunner bench(options);
+    bench.run("parseFileNameTime/spec", specNames.size(),
+              [&](size_t i) { return filetimefixer::parseFileNameTime(specNames[i]).size(); });
+    bench.run("parseFileNameTime/synthetic", names.size(),
+              [&](size_t i) { return filetimefixer::parseFileNameTime(names[i]).size(); });
+    bench.run("scanFileNameTime/synthetic", views.size(), [&](size_t i) {
+        FileNameTime t;
+        return filetimefixer::scanFileNameTime(views[i], t) ? fieldsChecksum(t) : 0;
+    });
+    const size_t kBatch = 4096;
+    std::vector<FileNameTime> batchTimes(kBatch);
+    bench.run("parseFileNameTimes/synthetic", views.size() / kBatch, [&](size_t i) {
+        return filetimefixer::parseFileNameTimes(std::span(views).subspan(i * kBatch, kBatch), batchTimes);
+    }, kBatch);
+    bench.run("parseUTCStringToTm/synthetic", utcStrings.size(), [&](size_t i) {
+        std::tm tm{};
+        return filetimefixer::parseUTCStringToTm(tm, utcStrings[i]) ? static_cast<uint64_t>(tm.tm_sec + tm.tm_mday) : 0;
+    });
+    bench.run("parseUTCStringToTm/stream_reference", utcStrings.size(), [&](size_t i) {
+        std::tm tm{};
+        return streamParseUTCStringToTm(tm, utcStrings[i]) ? static_cast<uint64_t>(tm.tm_sec + tm.tm_mday) : 0;
+    });
+    bench.run("exifDateTimeToTimeValue/synthetic", exifStrings.size(), [&](size_t i) {
+        return static_cast<uint64_t>(filetimefixer::exifDateTimeToTimeValue(exifStrings[i], zone).epochMs);
+    });
+    bench.run("formatTimeToLocalName/synthetic", values.size(), [&](size_t i) {
+        char buf[filetimefixer::kNameStemMaxLength];
+        size_t n = filetimefixer::formatTimeToLocalName(values[i], buf);
+        return n + static_cast<unsigned char>(buf[n - 1]);
+    });
+    bench.run("formatTimeForExif/synthetic", values.size(), [&](size_t i) {
+        char buf[filetimefixer::kExifTimeLength];
+        size_t n = filetimefixer::formatTimeForExif(values[i], buf);
+        return n + static_cast<unsigned char>(buf[n - 1]);
+    });
+    bench.run("resolveTargetTime/spec", specPairs.size(), [&](size_t i) {
+        return static_cast<uint64_t>(filetimefixer::resolveTargetTime(specPairs[i].first, specPairs[i].second, zone).scenario);
+    });
+    bench.run("resolveTargetTime/synthetic", pairs.size(), [&](size_t i) {
+        return static_cast<uint64_t>(filetimefixer::resolveTargetTime(pairs[i].first, pairs[i].second, zone).targetTime.epochMs);
+    });
+
+    const std::string executable = argc > 0 ? argv[0] : "FileTimeFixerBench";
+    if (options.outPath.empty()) {
+        bench.writeJson(std::cout, executable);
+    } else {
+        std::ofstream out(options.outPath);
+        bench.writeJson(out, executable);
+        if (!out) {
+            std::cerr << "Cannot write " << options.outPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
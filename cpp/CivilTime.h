@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+// Proleptic Gregorian calendar <-> days / seconds since 1970-01-01, as plain integer arithmetic.
+// Constant time, no locale, TZ or libc calls, so it is safe from any thread and usable in constexpr.
+// Algorithms after H. Hinnant, "chrono-Compatible Low-Level Date Algorithms" (400-year eras).
+
+namespace filetimefixer {
+
+constexpr int64_t kSecondsPerDay = 86400;
+
+struct CivilDateTime {
+    int64_t year = 1970;
+    int month = 1;   // 1..12
+    int day = 1;     // 1..31
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+};
+
+constexpr bool isLeapYear(int64_t year) {
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+// Days in month (1..12) of year; 0 for an invalid month
+constexpr int daysInMonth(int64_t year, int month) {
+    constexpr int kDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month < 1 || month > 12) return 0;
+    return month == 2 && isLeapYear(year) ? 29 : kDays[month - 1];
+}
+
+constexpr bool isValidCivilDate(int64_t year, int month, int day) {
+    return day >= 1 && day <= daysInMonth(year, month);
+}
+
+// Days since 1970-01-01 of year-month-day (fields must be valid)
+constexpr int64_t daysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yearOfEra = year - era * 400;                                          // [0, 399]
+    const int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0, 365]
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;  // [0, 146096]
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Date of the given day since 1970-01-01 (time fields left at 0)
+constexpr CivilDateTime civilFromDays(int64_t days) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;                                                    // [0, 146096]
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;  // [0, 399]
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);          // [0, 365]
+    const int64_t mp = (5 * dayOfYear + 2) / 153;                                                      // [0, 11]
+    CivilDateTime c;
+    c.day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    c.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    c.year = yearOfEra + era * 400 + (c.month <= 2);
+    return c;
+}
+
+// Seconds since the epoch of a UTC civil date/time (fields must be valid)
+constexpr int64_t civilToEpochSeconds(const CivilDateTime& c) {
+    return daysFromCivil(c.year, c.month, c.day) * kSecondsPerDay + c.hour * 3600 + c.minute * 60 + c.second;
+}
+
+// UTC civil date/time of seconds since the epoch (rounds toward the earlier second before 1970)
+constexpr CivilDateTime epochSecondsToCivil(int64_t seconds) {
+    int64_t days = seconds / kSecondsPerDay;
+    int64_t secondOfDay = seconds % kSecondsPerDay;
+    if (secondOfDay < 0) {
+        secondOfDay += kSecondsPerDay;
+        --days;
+    }
+    CivilDateTime c = civilFromDays(days);
+    c.hour = static_cast<int>(secondOfDay / 3600);
+    c.minute = static_cast<int>(secondOfDay % 3600 / 60);
+    c.second = static_cast<int>(secondOfDay % 60);
+    return c;
+}
+
+static_assert(daysFromCivil(1970, 1, 1) == 0);
+static_assert(daysFromCivil(2000, 3, 1) == 11017);
+static_assert(daysFromCivil(1969, 12, 31) == -1);
+static_assert(civilFromDays(-719468).year == 0 && civilFromDays(-719468).month == 3);
+static_assert(epochSecondsToCivil(951782400).month == 2 && epochSecondsToCivil(951782400).day == 29);  // 2000-02-29
+static_assert(epochSecondsToCivil(-1).year == 1969 && epochSecondsToCivil(-1).second == 59);
+
+}  // namespace filetimefixer
@@ -0,0 +1,219 @@
+#include "DirectoryScanner.h"
+#include "ImageUtil.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace filetimefixer {
+
+#ifdef __linux__
+
+namespace {
+
+// Kernel record returned by getdents64 (not exported by glibc headers)
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+const size_t kDirentBufferSize = 256 * 1024;  // Large batches: fewer READDIR round trips on NFS/CephFS
+
+class LinuxTreeScanner {
+public:
+    LinuxTreeScanner(const ScanCallbacks& callbacks, std::ostream& err) : callbacks_(callbacks), err_(err) {}
+
+    bool run(const fs::path& root, unsigned threads) {
+        root_ = root;
+        pending_.push_back(root);
+        if (threads <= 1) {
+            worker();
+            return rootReadOk_;
+        }
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back(&LinuxTreeScanner::worker, this);
+        for (auto& t : workers) t.join();
+        return rootReadOk_;
+    }
+
+private:
+    struct Found {
+        fs::path path;
+        bool isDirectory;
+    };
+
+    void worker() {
+        std::vector<char> buf(kDirentBufferSize);
+        for (;;) {
+            fs::path dir;
+            {
+                std::unique_lock<std::mutex> lk(queueMutex_);
+                queueCv_.wait(lk, [this] { return !pending_.empty() || active_ == 0; });
+                if (pending_.empty()) return;  // Nothing queued and nobody can add more
+                dir = std::move(pending_.back());
+                pending_.pop_back();
+                ++active_;
+            }
+            std::vector<fs::path> subdirs;
+            if (!readDirectory(dir, buf, subdirs) && dir == root_) rootReadOk_ = false;
+            {
+                std::lock_guard<std::mutex> lk(queueMutex_);
+                // Reverse so a single worker visits subdirectories in the order they were read
+                for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it)
+                    pending_.push_back(std::move(*it));
+                --active_;
+            }
+            queueCv_.notify_all();
+        }
+    }
+
+    // False if the directory could not be opened or read to the end
+    bool readDirectory(const fs::path& dir, std::vector<char>& buf, std::vector<fs::path>& subdirs) {
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            reportError(dir, std::string("Cannot open directory: ") + std::strerror(errno));
+            return false;
+        }
+        bool ok = true;
+        std::vector<Found> batch;
+        for (;;) {
+            long n = ::syscall(SYS_getdents64, fd, buf.data(), buf.size());
+            if (n < 0) {
+                reportError(dir, std::string("Cannot read directory: ") + std::strerror(errno));
+                ok = false;
+                break;
+            }
+            if (n == 0) break;
+            batch.clear();
+            for (long off = 0; off < n;) {
+                auto* d = reinterpret_cast<LinuxDirent64*>(buf.data() + off);
+                off += d->d_reclen;
+                const char* name = d->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+                classify(fd, dir, name, d->d_type, batch, subdirs);
+            }
+            deliver(batch);
+        }
+        ::close(fd);
+        return ok;
+    }
+
+    void reportError(const fs::path& dir, const std::string& message) {
+        std::lock_guard<std::mutex> lk(callbackMutex_);
+        err_ << message << " " << dir << std::endl;
+        if (callbacks_.onError) callbacks_.onError(dir, message);
+    }
+
+    void classify(int dirFd, const fs::path& dir, const char* name, unsigned char type,
+                  std::vector<Found>& batch, std::vector<fs::path>& subdirs) {
+        if (type == DT_DIR) {
+            subdirs.push_back(dir / name);
+            batch.push_back({ subdirs.back(), true });
+            return;
+        }
+        if (type == DT_REG) {
+            batch.push_back({ dir / name, false });
+            return;
+        }
+        bool follow = false;
+        if (type == DT_LNK) {
+            // Only symlinks that could be media are worth a stat; directory links are not followed
+            if (!isMediaFile(fs::path(name))) return;
+            follow = true;
+        } else if (type != DT_UNKNOWN) {
+            return;  // Sockets, fifos, devices
+        }
+        struct stat st;
+        if (::fstatat(dirFd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0) return;
+        if (S_ISREG(st.st_mode)) {
+            batch.push_back({ dir / name, false });
+        } else if (S_ISDIR(st.st_mode) && !follow) {
+            subdirs.push_back(dir / name);
+            batch.push_back({ subdirs.back(), true });
+        } else if (S_ISLNK(st.st_mode) && isMediaFile(fs::path(name))) {
+            // DT_UNKNOWN symlink: resolve like a DT_LNK entry
+            if (::fstatat(dirFd, name, &st, 0) == 0 && S_ISREG(st.st_mode))
+                batch.push_back({ dir / name, false });
+        }
+    }
+
+    void deliver(const std::vector<Found>& batch) {
+        if (batch.empty()) return;
+        std::lock_guard<std::mutex> lk(callbackMutex_);
+        for (const auto& f : batch) {
+            if (f.isDirectory) {
+                if (callbacks_.onDirectory) callbacks_.onDirectory(f.path);
+            } else if (callbacks_.onFile) {
+                callbacks_.onFile(f.path);
+            }
+        }
+    }
+
+    const ScanCallbacks& callbacks_;
+    std::ostream& err_;
+    std::mutex callbackMutex_;  // Serializes callbacks and err_
+    std::mutex queueMutex_;
+    std::condition_variable queueCv_;
+    std::vector<fs::path> pending_;  // Directories waiting to be read (LIFO: depth first)
+    unsigned active_ = 0;            // Directories being read right now
+    fs::path root_;
+    bool rootReadOk_ = true;         // Written by the one worker that reads root
+};
+
+}  // namespace
+
+bool scanDirectoryTree(const fs::path& root, const ScanOptions& options, const ScanCallbacks& callbacks,
+                       std::ostream& err) {
+    LinuxTreeScanner scanner(callbacks, err);
+    return scanner.run(root, options.threads == 0 ? 1 : options.threads);
+}
+
+#else
+
+bool scanDirectoryTree(const fs::path& root, const ScanOptions& options, const ScanCallbacks& callbacks,
+                       std::ostream& err) {
+    (void)options;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    auto reportError = [&](const fs::path& dir, const std::string& message) {
+        err << message << " " << dir << std::endl;
+        if (callbacks.onError) callbacks.onError(dir, message);
+    };
+    if (ec) {
+        reportError(root, "Cannot open directory: " + ec.message());
+        return false;
+    }
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) {
+            // The iterator cannot go on past an error: the rest of the tree is not scanned
+            reportError(root, "Directory read error: " + ec.message());
+            return false;
+        }
+        const auto& entry = *it;
+        if (entry.is_directory()) {
+            if (callbacks.onDirectory) callbacks.onDirectory(entry.path());
+        }
+        if (!fs::is_regular_file(entry.status())) continue;
+        if (callbacks.onFile) callbacks.onFile(entry.path());
+    }
+    return true;
+}
+
+#endif
+
+}  // namespace filetimefixer
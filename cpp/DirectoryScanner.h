@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+struct ScanOptions {
+    unsigned threads = 1;  // Directories read in parallel (Linux scanner only)
+};
+
+struct ScanCallbacks {
+    std::function<void(const fs::path& dir)> onDirectory;  // Every subdirectory found
+    std::function<void(const fs::path& file)> onFile;      // Every regular file found (media or not)
+    std::function<void(const fs::path& dir, const std::string& message)> onError;  // Directory that cannot be read
+};
+
+/// Recursively enumerate root. On Linux this reads directories in large batches with getdents64,
+/// trusts d_type and only stats entries whose type is unknown or symlinks with a media extension
+/// (non-media symlinks are skipped without a stat); subdirectories are read by `threads` workers.
+/// Elsewhere it uses fs::recursive_directory_iterator. Directory symlinks are not followed.
+/// Callbacks are never called concurrently. Unreadable directories are reported on err and to
+/// onError, and skipped. Returns false if root itself cannot be opened or read.
+bool scanDirectoryTree(const fs::path& root, const ScanOptions& options, const ScanCallbacks& callbacks,
+                       std::ostream& err);
+
+}  // namespace filetimefixer
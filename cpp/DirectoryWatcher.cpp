@@ -0,0 +1,180 @@
+#include "DirectoryWatcher.h"
+#include "DirectoryScanner.h"
+#include "ImageUtil.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace filetimefixer {
+
+#ifdef __linux__
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint32_t kDirMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+    | IN_DELETE_SELF | IN_ONLYDIR;
+
+class InotifyTree {
+public:
+    InotifyTree(const WatchOptions& options, std::ostream& err) : options_(options), err_(err) {}
+    ~InotifyTree() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool start(const fs::path& root) {
+        fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) {
+            err_ << "inotify_init1 failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (!addWatch(root)) return false;
+        addTree(root, false);
+        return true;
+    }
+
+    // Wait up to the next settle deadline for events; return files that have settled.
+    void poll(std::vector<fs::path>& settled) {
+        int timeoutMs = 500;
+        auto now = Clock::now();
+        for (const auto& [path, deadline] : pending_) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            timeoutMs = static_cast<int>(std::max<long long>(0, std::min<long long>(timeoutMs, ms)));
+        }
+        struct pollfd pfd = { fd_, POLLIN, 0 };
+        if (::poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN))
+            drainEvents();
+        now = Clock::now();
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            if (it->second <= now) {
+                settled.push_back(it->first);
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    bool addWatch(const fs::path& dir) {
+        int wd = ::inotify_add_watch(fd_, dir.c_str(), kDirMask);
+        if (wd < 0) {
+            err_ << "Cannot watch " << dir << ": " << std::strerror(errno);
+            if (errno == ENOSPC) err_ << " (raise fs.inotify.max_user_watches)";
+            err_ << std::endl;
+            return false;
+        }
+        dirs_[wd] = dir;
+        return true;
+    }
+
+    // Watch every subdirectory of dir; with reportFiles, queue media files already inside
+    // (a directory moved into the tree arrives complete, without per-file events).
+    void addTree(const fs::path& dir, bool reportFiles) {
+        ScanCallbacks callbacks;
+        callbacks.onDirectory = [&](const fs::path& sub) { addWatch(sub); };
+        if (reportFiles) {
+            callbacks.onFile = [&](const fs::path& file) {
+                if (isMediaFile(file)) touch(file);
+            };
+        }
+        scanDirectoryTree(dir, ScanOptions{}, callbacks, err_);
+    }
+
+    void touch(const fs::path& file) {
+        pending_[file] = Clock::now() + options_.settle;
+    }
+
+    void drainEvents() {
+        alignas(struct inotify_event) char buf[64 * 1024];
+        for (;;) {
+            ssize_t n = ::read(fd_, buf, sizeof(buf));
+            if (n <= 0) return;  // EAGAIN: drained
+            for (char* p = buf; p < buf + n;) {
+                auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+                handle(*ev);
+            }
+        }
+    }
+
+    void handle(const struct inotify_event& ev) {
+        if (ev.mask & IN_Q_OVERFLOW) {
+            err_ << "[Watch] inotify queue overflow: some events were lost; run a full pass to catch up" << std::endl;
+            return;
+        }
+        auto dirIt = dirs_.find(ev.wd);
+        if (dirIt == dirs_.end()) return;
+        if (ev.mask & (IN_DELETE_SELF | IN_IGNORED)) {
+            dirs_.erase(dirIt);
+            return;
+        }
+        if (ev.len == 0) return;
+        fs::path path = dirIt->second / ev.name;
+        if (ev.mask & IN_ISDIR) {
+            if (ev.mask & (IN_CREATE | IN_MOVED_TO)) {
+                if (addWatch(path)) addTree(path, true);
+            }
+            return;
+        }
+        if (!isMediaFile(path)) return;
+        if (ev.mask & (IN_DELETE | IN_MOVED_FROM)) {
+            pending_.erase(path);
+        } else if (ev.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+            touch(path);
+        } else if (ev.mask & IN_MODIFY) {
+            // Still being written: push the deadline out if it was already waiting
+            auto it = pending_.find(path);
+            if (it != pending_.end()) it->second = Clock::now() + options_.settle;
+        }
+    }
+
+    const WatchOptions& options_;
+    std::ostream& err_;
+    int fd_ = -1;
+    std::unordered_map<int, fs::path> dirs_;  // Watch descriptor -> directory
+    std::map<fs::path, Clock::time_point> pending_;
+};
+
+}  // namespace
+
+bool watchDirectoryTree(const fs::path& root, const WatchOptions& options,
+                        const std::function<void(const fs::path& file)>& onSettled,
+                        const std::atomic<bool>& stop, std::ostream& err) {
+    InotifyTree tree(options, err);
+    if (!tree.start(root)) return false;
+    std::vector<fs::path> settled;
+    while (!stop) {
+        settled.clear();
+        tree.poll(settled);
+        for (const auto& file : settled) {
+            if (stop) break;
+            onSettled(file);
+        }
+    }
+    return true;
+}
+
+#else
+
+bool watchDirectoryTree(const fs::path& root, const WatchOptions& options,
+                        const std::function<void(const fs::path& file)>& onSettled,
+                        const std::atomic<bool>& stop, std::ostream& err) {
+    (void)root; (void)options; (void)onSettled; (void)stop;
+    err << "--watch is only supported on Linux (inotify)" << std::endl;
+    return false;
+}
+
+#endif
+
+}  // namespace filetimefixer
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+struct WatchOptions {
+    std::chrono::milliseconds settle{ 2000 };  // Quiet time after the last close/move before a file is handed over
+};
+
+/// Watch root and all its subdirectories (inotify, Linux only). A media file is reported through
+/// onSettled once it has been closed after writing (or moved into the tree) and no further event
+/// arrived for it during options.settle. Directories created or moved in later are watched too,
+/// and media files already inside a moved-in directory are reported. Runs until stop is set;
+/// returns false if watching cannot start (or on non-Linux platforms).
+bool watchDirectoryTree(const fs::path& root, const WatchOptions& options,
+                        const std::function<void(const fs::path& file)>& onSettled,
+                        const std::atomic<bool>& stop, std::ostream& err);
+
+}  // namespace filetimefixer
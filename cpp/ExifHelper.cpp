@@ -1,12 +1,19 @@
 #include "ExifHelper.h"
 #include "TimeConvert.h"
+#include "IoBudget.h"
+#include "MappedIo.h"
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <filesystem>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace filetimefixer {
@@ -66,149 +73,149 @@ static std::string pathForExiv2WindowsShortPath(const std::string& filepath) {
     return result;
 }
 
-// Open file via temp copy when direct path fails (e.g. Unicode path).
-static bool getExifDataViaTemp(const std::string& filepath, Exiv2::ExifData& exifData) {
-    namespace fs = std::filesystem;
-    fs::path p(filepath);
-    if (!fs::is_regular_file(p)) return false;
-    fs::path tmpPath = fs::temp_directory_path() / ("ftf_read_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + p.extension().string());
+#endif
+
+static std::atomic<bool> s_exiv2ErrorLogged{false};
+static void logExiv2ErrorOnce(const char* msg) {
+    if (!s_exiv2ErrorLogged.exchange(true)) {
+        std::cerr << "Exiv2: " << msg << " (EXIF read/write may be skipped for some files on this system.)" << std::endl;
+    }
+}
+
+// Write value over the bytes at each offset of the file: no truncation, no temp file, no copy
+static bool overwriteInPlace(const std::string& filepath, const uint64_t* offsets, size_t count, const std::string& value) {
+#ifdef _WIN32
+    std::wstring wpath = std::filesystem::path(filepath).wstring();
+    HANDLE hFile = CreateFileW(wpath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; ++i) {
+        OVERLAPPED at = {};
+        at.Offset = static_cast<DWORD>(offsets[i]);
+        at.OffsetHigh = static_cast<DWORD>(offsets[i] >> 32);
+        DWORD written = 0;
+        ok = WriteFile(hFile, value.data(), static_cast<DWORD>(value.size()), &written, &at) && written == value.size();
+    }
+    return CloseHandle(hFile) && ok;
+#else
+    int fd = ::open(filepath.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; ++i)
+        ok = ::pwrite(fd, value.data(), value.size(), static_cast<off_t>(offsets[i])) == static_cast<ssize_t>(value.size());
+    return ::close(fd) == 0 && ok;
+#endif
+}
+
+ExifSession::~ExifSession() {
+    removeTempCopy();
+}
+
+bool ExifSession::open(const std::string& filepath) {
+    image_.reset();
+    nativeTags_.reset();
+    removeTempCopy();
+    path_ = filepath;
+    backing_ = Backing::Path;
+    chargeMetadataOps();
+    chargeReadBytes(headerReadBytes(filepath));
+    // Exiv2 reads from a mapping of the file and never sees the path (on Windows a path-based open
+    // can trigger abort() in Debug with Exiv2/vcpkg, and fopen fails on names outside the code page)
+    if (openMapped())
+        return true;
+#ifdef _WIN32
+    if (openPath(pathForExiv2(filepath)))
+        return true;
+    logExiv2ErrorOnce("Direct path failed, trying short path or temp copy");
+    std::string shortPath = pathForExiv2WindowsShortPath(filepath);
+    if (!shortPath.empty() && openPath(shortPath))
+        return true;
+    if (openViaTempCopy())
+        return true;
+#else
+    if (openPath(pathForExiv2(filepath)))
+        return true;
+#endif
+    logExiv2ErrorOnce("Unable to open file");
+    return false;
+}
+
+bool ExifSession::openPath(const std::string& pathToOpen) {
     try {
-        fs::copy_file(p, tmpPath, fs::copy_options::overwrite_existing);
-        std::string pathToOpen = pathToAcp(tmpPath);
-        if (pathToOpen.empty()) pathToOpen = pathForExiv2(tmpPath.string());
         auto image = Exiv2::ImageFactory::open(pathToOpen);
-        if (!image.get()) { fs::remove(tmpPath); return false; }
-        image->readMetadata();
-        exifData = image->exifData();
-        fs::remove(tmpPath);
+        if (!image.get()) return false;
+        try { image->readMetadata(); }
+        catch (const Exiv2::Error& e) { logExiv2ErrorOnce(e.what()); return false; }
+        image_ = std::move(image);
         return true;
-    } catch (...) {
-        try { fs::remove(tmpPath); } catch (...) {}
+    } catch (const Exiv2::Error& e) {
+        (void)e;
         return false;
     }
 }
 
-// Read file into memory and open via MemIo so Exiv2 never sees a path (works when path/open fails).
-static bool getExifDataViaMemIo(const std::string& filepath, Exiv2::ExifData& exifData) {
-    namespace fs = std::filesystem;
-    fs::path p(filepath);
-    if (!fs::is_regular_file(p)) return false;
-    std::ifstream in(p, std::ios::binary | std::ios::ate);
-    if (!in) return false;
-    const std::streamsize sz = in.tellg();
-    if (sz <= 0 || sz > 100 * 1024 * 1024) return false;  // cap 100MB
-    in.seekg(0);
-    std::vector<Exiv2::byte> buf(static_cast<size_t>(sz));
-    if (!in.read(reinterpret_cast<char*>(buf.data()), sz)) return false;
-    in.close();
+// Open through a MappedIo: no copy of the file and no size limit; writes go straight to path_
+bool ExifSession::openMapped() {
     try {
-        Exiv2::BasicIo::UniquePtr io(new Exiv2::MemIo(buf.data(), buf.size()));
+        Exiv2::BasicIo::UniquePtr io(new MappedIo(path_));
         auto image = Exiv2::ImageFactory::open(std::move(io));
         if (!image.get()) return false;
         image->readMetadata();
-        exifData = image->exifData();
+        image_ = std::move(image);
+        backing_ = Backing::Mapped;
         return true;
-    } catch (const Exiv2::Error&) {
+    } catch (const std::exception&) {  // Exiv2::Error, or bad_alloc / system_error from the mapping
         return false;
     }
 }
 
-// Modify EXIF by reading file into MemIo, so Exiv2 never sees a path.
-static bool modifyExifDataForTimeViaMemIo(const std::string& filepath, const std::string& exifValue) {
+#ifdef _WIN32
+// Open a temp copy when direct path fails (e.g. Unicode path); writes are copied back.
+bool ExifSession::openViaTempCopy() {
     namespace fs = std::filesystem;
-    fs::path p(filepath);
+    fs::path p(path_);
     if (!fs::is_regular_file(p)) return false;
-    std::ifstream in(p, std::ios::binary | std::ios::ate);
-    if (!in) return false;
-    const std::streamsize sz = in.tellg();
-    if (sz <= 0 || sz > 100 * 1024 * 1024) return false;
-    in.seekg(0);
-    std::vector<Exiv2::byte> buf(static_cast<size_t>(sz));
-    if (!in.read(reinterpret_cast<char*>(buf.data()), sz)) return false;
-    in.close();
+    tempPath_ = fs::temp_directory_path() / ("ftf_exif_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + p.extension().string());
     try {
-        Exiv2::BasicIo::UniquePtr io(new Exiv2::MemIo(buf.data(), buf.size()));
-        auto image = Exiv2::ImageFactory::open(std::move(io));
-        if (!image.get()) return false;
-        image->readMetadata();
-        Exiv2::ExifData& exifData = image->exifData();
-        for (const auto& tag : exifTimeTags()) {
-            Exiv2::ExifKey key(tag);
-            auto pos = exifData.findKey(key);
-            if (pos != exifData.end()) {
-                pos->setValue(exifValue);
-            } else {
-                auto value = Exiv2::Value::create(Exiv2::asciiString);
-                value->read(exifValue);
-                exifData.add(key, value.get());
-            }
+        fs::copy_file(p, tempPath_, fs::copy_options::overwrite_existing);
+        std::string pathToOpen = pathToAcp(tempPath_);
+        if (pathToOpen.empty()) pathToOpen = pathForExiv2(tempPath_.string());
+        if (!openPath(pathToOpen)) {
+            removeTempCopy();
+            return false;
         }
-        image->writeMetadata();
-        Exiv2::BasicIo& bio = image->io();
-        if (bio.seek(0, Exiv2::BasicIo::beg) != 0) return false;
-        Exiv2::DataBuf data = bio.read(bio.size());
-        if (data.size() == 0) return false;
-        std::ofstream out(p, std::ios::binary);
-        if (!out) return false;
-        out.write(reinterpret_cast<const char*>(data.c_data()), data.size());
-        return out.good();
-    } catch (const Exiv2::Error&) {
+        backing_ = Backing::TempCopy;
+        return true;
+    } catch (...) {
+        removeTempCopy();
         return false;
     }
 }
 #endif
 
-static bool s_exiv2ErrorLogged = false;
-static void logExiv2ErrorOnce(const char* msg) {
-    if (!s_exiv2ErrorLogged) {
-        std::cerr << "Exiv2: " << msg << " (EXIF read/write may be skipped for some files on this system.)" << std::endl;
-        s_exiv2ErrorLogged = true;
-    }
+void ExifSession::removeTempCopy() {
+    if (tempPath_.empty()) return;
+    std::error_code ec;
+    std::filesystem::remove(tempPath_, ec);
+    tempPath_.clear();
 }
 
-bool getExifData(const std::string& filepath, Exiv2::ExifData& exifData) {
-    auto tryOpen = [&](const std::string& pathToOpen) -> bool {
-        try {
-            auto image = Exiv2::ImageFactory::open(pathToOpen);
-            if (!image.get()) return false;
-            try { image->readMetadata(); }
-            catch (const Exiv2::Error& e) { logExiv2ErrorOnce(e.what()); return false; }
-            exifData = image->exifData();
-            return true;
-        } catch (const Exiv2::Error& e) {
-            (void)e;
-            return false;
-        }
-    };
-
-#ifdef _WIN32
-    // On Windows, path-based open can trigger abort() in Debug (Exiv2/vcpkg). Try MemIo first so Exiv2 never sees a path.
-    if (getExifDataViaMemIo(filepath, exifData))
-        return true;
-    if (tryOpen(pathForExiv2(filepath)))
-        return true;
-    logExiv2ErrorOnce("Direct path failed, trying short path or temp copy");
-    std::string shortPath = pathForExiv2WindowsShortPath(filepath);
-    if (!shortPath.empty() && tryOpen(shortPath))
-        return true;
-    if (getExifDataViaTemp(filepath, exifData))
-        return true;
-#else
-    if (tryOpen(pathForExiv2(filepath)))
-        return true;
-#endif
-    logExiv2ErrorOnce("Unable to open file");
-    return false;
+const Exiv2::ExifData& ExifSession::exifData() const {
+    static const Exiv2::ExifData empty;
+    return image_ ? image_->exifData() : empty;
 }
 
-std::string getExifTimeEarliest(const std::string& filePath) {
-    Exiv2::ExifData exifData;
-    if (!getExifData(filePath, exifData)) return "";
+std::string ExifSession::earliestTime(std::string& offsetTimeOriginal) const {
+    offsetTimeOriginal.clear();
+    const Exiv2::ExifData& data = exifData();
+    auto offset = data.findKey(Exiv2::ExifKey("Exif.Photo.OffsetTimeOriginal"));
+    if (offset != data.end()) offsetTimeOriginal = offset->toString();
     std::string earliestTime;
     for (const auto& tag : exifTimeTags()) {
         Exiv2::ExifKey key(tag);
-        auto pos = exifData.findKey(key);
-        if (pos != exifData.end()) {
+        auto pos = data.findKey(key);
+        if (pos != data.end()) {
             std::string timeStr = pos->toString();
             if (earliestTime.empty() || timeStr < earliestTime)
                 earliestTime = timeStr;
@@ -217,24 +224,95 @@ std::string getExifTimeEarliest(const std::string& filePath) {
     return earliestTime;
 }
 
-// EXIF DateTime* tags require format "YYYY:MM:DD HH:MM:SS" (colons in date).
-std::string formatTimeForExif(const std::string& timeStr) {
-    std::string out = timeStr;
-    if (out.size() >= 10 && out[4] == '-' && out[7] == '-') {
-        out[4] = ':';
-        out[7] = ':';
+void ExifSession::retarget(const std::string& filepath) {
+    path_ = filepath;
+    // Temp copies are written back to path_; a mapped or path-opened file is written through its io
+    if (backing_ == Backing::Mapped) {
+        if (auto* mappedIo = dynamic_cast<MappedIo*>(&image_->io()))
+            mappedIo->setPath(filepath);
+    } else if (backing_ == Backing::Path) {
+        if (auto* fileIo = dynamic_cast<Exiv2::FileIo*>(&image_->io()))
+            fileIo->setPath(pathForExiv2(filepath));
     }
-    if (out.size() > 10 && out[10] == 'T')
-        out[10] = ' ';
-    return out;
 }
 
-static bool modifyExifDataForTimeImpl(const std::string& pathToOpen, const std::string& exifValue) {
+// All three time tags hold value already
+static bool timeTagsAre(const ExifTimeTags& tags, const std::string& value) {
+    for (const ExifTimeTag* tag : { &tags.dateTimeOriginal, &tags.dateTimeDigitized, &tags.dateTime })
+        if (!tag->present || tag->value != value) return false;
+    return true;
+}
+
+static bool timeTagsAre(const Exiv2::ExifData& exifData, const std::string& value) {
+    for (const auto& tag : exifTimeTags()) {
+        auto pos = exifData.findKey(Exiv2::ExifKey(tag));
+        if (pos == exifData.end() || pos->toString() != value) return false;
+    }
+    return true;
+}
+
+bool ExifSession::writeTime(const std::string& filepath, const TimeValue& targetTime, bool& alreadySet) {
+    alreadySet = false;
+    const bool carried = isOpen();
+    const std::string exifValue = formatTimeForExif(targetTime);
+    if (!carried) {
+        // A carried session means the native reader could not read this file, so it cannot patch it either
+        ExifTimeTags tags;
+        if (readExifTimeTagsNative(filepath, tags) == ExifReadStatus::Ok) {
+            alreadySet = timeTagsAre(tags, exifValue);
+            if (alreadySet || patchInPlace(filepath, tags, exifValue)) {
+                keepNativeTags(filepath, tags);
+                return true;
+            }
+        }
+        if (!open(filepath)) return false;
+    } else if (filepath != path_) {
+        retarget(filepath);
+    }
+    if (timeTagsAre(image_->exifData(), exifValue)) {
+        alreadySet = true;
+        return true;
+    }
+    // writeMetadata rewrites the whole file
+    uint64_t fileSize = fileSizeForBudget(filepath);
+    chargeMetadataOps();
+    chargeReadBytes(fileSize);
+    chargeWriteBytes(fileSize);
+    if (writeOnce(exifValue))
+        return true;
+    // A session carried from the read stage may be stale (e.g. a renamed path Exiv2 cannot reopen)
+    if (carried && open(filepath) && writeOnce(exifValue))
+        return true;
+    open(filepath);  // Report what the file holds now, not the values that failed to write
+    return false;
+}
+
+// tags: as read natively; on success they are as read back after the write
+bool ExifSession::patchInPlace(const std::string& filepath, ExifTimeTags& tags, const std::string& exifValue) {
+    if (exifValue.size() != kExifTimeLength) return false;
+    // Every tag must be there as a 19-char value + NUL, the slot the new value fills exactly
+    uint64_t offsets[3];
+    size_t count = 0;
+    for (const ExifTimeTag* tag : { &tags.dateTimeOriginal, &tags.dateTimeDigitized, &tags.dateTime }) {
+        if (!tag->present || tag->count != kExifTimeLength + 1 || tag->value.size() != kExifTimeLength) return false;
+        offsets[count++] = tag->fileOffset;
+    }
+    chargeMetadataOps();
+    chargeWriteBytes(count * kExifTimeLength);
+    if (!overwriteInPlace(filepath, offsets, count, exifValue)) return false;
+    // Read back what is on disk now
+    return readExifTimeTagsNative(filepath, tags) == ExifReadStatus::Ok && timeTagsAre(tags, exifValue);
+}
+
+void ExifSession::keepNativeTags(const std::string& filepath, const ExifTimeTags& tags) {
+    image_.reset();
+    path_ = filepath;
+    nativeTags_ = tags;
+}
+
+bool ExifSession::writeOnce(const std::string& exifValue) {
     try {
-        auto image = Exiv2::ImageFactory::open(pathToOpen);
-        if (!image.get()) return false;
-        image->readMetadata();
-        Exiv2::ExifData& exifData = image->exifData();
+        Exiv2::ExifData& exifData = image_->exifData();
         for (const auto& tag : exifTimeTags()) {
             Exiv2::ExifKey key(tag);
             auto pos = exifData.findKey(key);
@@ -246,65 +324,126 @@ static bool modifyExifDataForTimeImpl(const std::string& pathToOpen, const std::
                 exifData.add(key, value.get());
             }
         }
-        image->writeMetadata();
+        image_->writeMetadata();
+        if (backing_ == Backing::TempCopy)
+            std::filesystem::copy_file(tempPath_, path_, std::filesystem::copy_options::overwrite_existing);
         return true;
     } catch (const Exiv2::Error&) {
         return false;
+    } catch (const std::filesystem::filesystem_error&) {
+        return false;
     }
 }
 
-bool modifyExifDataForTime(const std::string& filepath, const std::string& new_datetime) {
-    std::string exifValue = formatTimeForExif(new_datetime);
-#ifdef _WIN32
-    // Prefer MemIo on Windows to avoid path-based open triggering abort() in Debug.
-    if (modifyExifDataForTimeViaMemIo(filepath, exifValue))
-        return true;
-    if (modifyExifDataForTimeImpl(pathForExiv2(filepath), exifValue))
-        return true;
-    std::string shortPath = pathForExiv2WindowsShortPath(filepath);
-    if (!shortPath.empty() && modifyExifDataForTimeImpl(shortPath, exifValue))
-        return true;
-    logExiv2ErrorOnce("Short path failed, trying via temp file");
-    std::filesystem::path p(filepath);
-    auto tmpPath = std::filesystem::temp_directory_path() / ("ftf_exif_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + p.extension().string());
-    try {
-        std::filesystem::copy_file(p, tmpPath, std::filesystem::copy_options::overwrite_existing);
-        bool ok = false;
-        std::string pathToOpen = pathToAcp(tmpPath);
-        if (pathToOpen.empty()) pathToOpen = pathForExiv2(tmpPath.string());
-        if (modifyExifDataForTimeImpl(pathToOpen, exifValue)) {
-            std::filesystem::copy_file(tmpPath, p, std::filesystem::copy_options::overwrite_existing);
-            ok = true;
+std::string ExifSession::timeInfoString() const {
+    if (!isOpen() && !nativeTags_) return "(EXIF read failed)";
+    const Exiv2::ExifData& data = exifData();
+    std::string out;
+    for (size_t i = 0; i < exifTimeTags().size(); ++i) {
+        const std::string& tag = exifTimeTags()[i];
+        std::string value;
+        if (nativeTags_) {
+            // Same order as exifTimeTags()
+            const ExifTimeTag* native[] = { &nativeTags_->dateTimeOriginal, &nativeTags_->dateTimeDigitized, &nativeTags_->dateTime };
+            if (!native[i]->present) continue;
+            value = native[i]->value;
+        } else {
+            auto pos = data.findKey(Exiv2::ExifKey(tag));
+            if (pos == data.end()) continue;
+            value = pos->toString();
         }
-        std::filesystem::remove(tmpPath);
-        if (ok) return true;
-    } catch (...) {
-        try { std::filesystem::remove(tmpPath); } catch (...) {}
+        if (!out.empty()) out += "; ";
+        out += tag;
+        out += "=";
+        out += value;
     }
-    return false;
-#else
-    if (modifyExifDataForTimeImpl(pathForExiv2(filepath), exifValue))
-        return true;
-    logExiv2ErrorOnce("Failed to open file");
-    return false;
-#endif
+    return out.empty() ? "(no EXIF time tags)" : out;
 }
 
-std::string getExifTimeInfoString(const std::string& filePath) {
-    Exiv2::ExifData exifData;
-    if (!getExifData(filePath, exifData)) return "(EXIF read failed)";
-    std::string out;
-    for (const auto& tag : exifTimeTags()) {
-        Exiv2::ExifKey key(tag);
-        auto pos = exifData.findKey(key);
-        if (pos != exifData.end()) {
-            if (!out.empty()) out += "; ";
-            out += tag;
-            out += "=";
-            out += pos->toString();
+bool getExifData(const std::string& filepath, Exiv2::ExifData& exifData) {
+    ExifSession session;
+    if (!session.open(filepath)) return false;
+    exifData = session.exifData();
+    return true;
+}
+
+std::string getExifTimeEarliest(const std::string& filePath) {
+    std::string offsetTimeOriginal;
+    return getExifTimeEarliest(filePath, offsetTimeOriginal);
+}
+
+std::string getExifTimeEarliest(const std::string& filePath, std::string& offsetTimeOriginal) {
+    ExifSession session;
+    return getExifTimeEarliest(filePath, offsetTimeOriginal, session);
+}
+
+std::string getExifTimeEarliest(const std::string& filePath, std::string& offsetTimeOriginal, ExifSession& session) {
+    offsetTimeOriginal.clear();
+    ExifTimeTags tags;
+    if (readExifTimeTagsNative(filePath, tags) != ExifReadStatus::Unsupported) {
+        offsetTimeOriginal = tags.offsetTimeOriginal.value;
+        return earliestExifTime(tags);
+    }
+    if (!session.open(filePath)) return "";
+    return session.earliestTime(offsetTimeOriginal);
+}
+
+ExifReadStatus readExifTimeTagsNative(const std::string& filepath, ExifTimeTags& tags) {
+    namespace fs = std::filesystem;
+    const fs::path p(filepath);
+    std::error_code ec;
+    const uint64_t fileSize = fs::file_size(p, ec);
+    if (ec) return ExifReadStatus::Unsupported;
+    std::ifstream in(p, std::ios::binary);
+    if (!in) return ExifReadStatus::Unsupported;
+    chargeMetadataOps();
+    chargeReadBytes(headerReadBytes(filepath));
+    // The JPEG segments / TIFF IFDs wanted are nearly always in the first block; reads past it (IFDs
+    // far into a raw file) go to the file directly
+    static constexpr size_t kFirstBlock = 16 * 1024;
+    std::vector<uint8_t> head(static_cast<size_t>(std::min<uint64_t>(fileSize, kFirstBlock)));
+    if (!in.read(reinterpret_cast<char*>(head.data()), static_cast<std::streamsize>(head.size())))
+        return ExifReadStatus::Unsupported;
+    auto readAt = [&](uint64_t offset, uint8_t* dst, size_t n) {
+        if (offset + n <= head.size()) {
+            std::memcpy(dst, head.data() + offset, n);
+            return true;
         }
+        if (offset + n > fileSize) return false;
+        in.clear();
+        return static_cast<bool>(in.seekg(static_cast<std::streamoff>(offset))
+                                 && in.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n)));
+    };
+    return readExifTimeTags(readAt, fileSize, tags);
+}
+
+// EXIF DateTime* tags require format "YYYY:MM:DD HH:MM:SS" (colons in date).
+std::string formatTimeForExif(const std::string& timeStr) {
+    std::string out = timeStr;
+    if (out.size() >= 10 && out[4] == '-' && out[7] == '-') {
+        out[4] = ':';
+        out[7] = ':';
     }
-    return out.empty() ? "(no EXIF time tags)" : out;
+    if (out.size() > 10 && out[10] == 'T')
+        out[10] = ' ';
+    return out;
+}
+
+std::string formatTimeForExif(const TimeValue& value) {
+    char buf[kExifTimeLength];
+    return std::string(buf, formatTimeForExif(value, buf));
+}
+
+bool modifyExifDataForTime(const std::string& filepath, const TimeValue& targetTime) {
+    ExifSession session;
+    bool alreadySet = false;
+    return session.writeTime(filepath, targetTime, alreadySet);
+}
+
+std::string getExifTimeInfoString(const std::string& filePath) {
+    ExifSession session;
+    session.open(filePath);
+    return session.timeInfoString();
 }
 
 void printExifTime(const std::string& filePath) {
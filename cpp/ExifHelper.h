@@ -1,20 +1,92 @@
 #pragma once
 
+#include "ExifTimeReader.h"
+#include "TimeValue.h"
 #include <exiv2/exiv2.hpp>
+#include <filesystem>
+#include <optional>
 #include <string>
 
 namespace filetimefixer {
 
+// One Exiv2 open per image: the metadata is parsed once, then the times are read, changed, written
+// and reported from memory. When the read stage needs Exiv2 (formats the native reader does not
+// handle) it hands its session to the write stage with the plan, so the file is not parsed again
+// to write or to verify. Used by one thread at a time.
+class ExifSession {
+public:
+    ExifSession() = default;
+    ExifSession(const ExifSession&) = delete;
+    ExifSession& operator=(const ExifSession&) = delete;
+    ~ExifSession();
+
+    /// Open filepath and read its metadata; false if Exiv2 cannot read it
+    bool open(const std::string& filepath);
+    bool isOpen() const { return image_ != nullptr; }
+
+    /// Metadata as read (empty if not open), or as written after writeTime
+    const Exiv2::ExifData& exifData() const;
+    /// Earliest of DateTimeOriginal / DateTimeDigitized / Image.DateTime ("" if none), and
+    /// Exif.Photo.OffsetTimeOriginal ("" if absent)
+    std::string earliestTime(std::string& offsetTimeOriginal) const;
+
+    /// Set all three EXIF time tags to targetTime (on its own wall clock) in the file at filepath,
+    /// which may be the opened file's new name after a rename. Nothing is written when the tags
+    /// already hold that value (alreadySet). When a JPEG / TIFF already has all three tags as
+    /// 19-char values, the new value is written over them in place and read back (no Exiv2, no file
+    /// rewrite); otherwise Exiv2 rewrites the file, opening it first if the session is not open. On
+    /// failure the session holds the file as it is now.
+    bool writeTime(const std::string& filepath, const TimeValue& targetTime, bool& alreadySet);
+
+    /// The three EXIF time tags for output/log as held in memory, i.e. as written after writeTime;
+    /// "(EXIF read failed)" if nothing was read
+    std::string timeInfoString() const;
+
+private:
+    // Where Exiv2 reads from and writes to: the file through a MappedIo, the file by path (Exiv2's
+    // FileIo), or a temp copy of the file copied back (Windows, paths fopen cannot open)
+    enum class Backing { Mapped, Path, TempCopy };
+
+    bool openMapped();
+    bool openPath(const std::string& pathToOpen);
+#ifdef _WIN32
+    bool openViaTempCopy();
+#endif
+    void removeTempCopy();
+    void retarget(const std::string& filepath);
+    bool patchInPlace(const std::string& filepath, ExifTimeTags& tags, const std::string& exifValue);
+    void keepNativeTags(const std::string& filepath, const ExifTimeTags& tags);
+    bool writeOnce(const std::string& exifValue);
+
+    std::string path_;
+    Backing backing_ = Backing::Path;
+    std::filesystem::path tempPath_;
+    Exiv2::Image::UniquePtr image_;
+    std::optional<ExifTimeTags> nativeTags_;  // Read natively by writeTime (image_ is null then)
+};
+
 bool getExifData(const std::string& filepath, Exiv2::ExifData& exifData);
 
+// EXIF time tags of a JPEG or TIFF-based file read natively (ExifTimeReader.h): a few KB from the
+// start of the file, no Exiv2. Unsupported for other formats or layouts; use Exiv2 then.
+ExifReadStatus readExifTimeTagsNative(const std::string& filepath, ExifTimeTags& tags);
+
 // Return earliest of EXIF DateTimeOriginal / DateTimeDigitized / Image.DateTime; empty if none found
 std::string getExifTimeEarliest(const std::string& filePath);
+// Same, also giving Exif.Photo.OffsetTimeOriginal ("+08:00"; "" if absent)
+std::string getExifTimeEarliest(const std::string& filePath, std::string& offsetTimeOriginal);
+// Same; files the native reader cannot handle are read through session, which stays open so the
+// write stage can reuse it (not opened at all for JPEG / TIFF)
+std::string getExifTimeEarliest(const std::string& filePath, std::string& offsetTimeOriginal, ExifSession& session);
 
 // Convert "YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DDTHH:MM:SS" to EXIF format "YYYY:MM:DD HH:MM:SS"
 std::string formatTimeForExif(const std::string& timeStr);
 
-// Set all three EXIF time tags to new_datetime (format "YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DDTHH:MM:SS")
-bool modifyExifDataForTime(const std::string& filepath, const std::string& new_datetime);
+// value on its own wall clock (TimeValue::offsetMinutes) in EXIF format "YYYY:MM:DD HH:MM:SS"
+std::string formatTimeForExif(const TimeValue& value);
+
+// Set all three EXIF time tags to targetTime (written on its own wall clock)
+bool modifyExifDataForTime(const std::string& filepath, const TimeValue& targetTime);
 
 // Read and return string of the three EXIF time tags for output/log; "(none)" or partial on failure
 std::string getExifTimeInfoString(const std::string& filePath);
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Reads the EXIF date/time tags straight from the TIFF structure of a JPEG (APP1 "Exif") or a
+// TIFF-based file (TIFF, DNG, CR2, NEF, ARW, ...): IFD0 and the Exif sub-IFD only, no maker notes,
+// nothing copied but the few strings wanted. Byte access goes through a caller-supplied
+// readAt(offset, dst, n) so only the parts actually walked are read from disk. Anything unusual
+// (other formats, odd tag types, offsets out of range) is reported as Unsupported, and the caller
+// uses Exiv2 instead.
+
+namespace filetimefixer {
+
+// One ASCII tag as stored in the file
+struct ExifTimeTag {
+    bool present = false;
+    std::string value;        // Up to the first NUL, as Exiv2 prints it
+    uint64_t fileOffset = 0;  // Where the value bytes are in the file
+    uint32_t count = 0;       // Stored length including the NUL
+};
+
+struct ExifTimeTags {
+    ExifTimeTag dateTimeOriginal;   // Exif.Photo.DateTimeOriginal (0x9003)
+    ExifTimeTag dateTimeDigitized;  // Exif.Photo.DateTimeDigitized (0x9004)
+    ExifTimeTag dateTime;           // Exif.Image.DateTime (0x0132)
+    ExifTimeTag offsetTimeOriginal; // Exif.Photo.OffsetTimeOriginal (0x9011)
+};
+
+enum class ExifReadStatus {
+    Ok,           // Parsed; tags that are not in the file have present == false
+    NoExif,       // A JPEG without an EXIF segment: no tags at all
+    Unsupported,  // Not a JPEG / TIFF, or a layout this reader does not handle: ask Exiv2
+};
+
+namespace detail {
+
+class TiffWalker {
+public:
+    TiffWalker(uint64_t base, uint64_t length, bool littleEndian)
+        : base_(base), length_(length), littleEndian_(littleEndian) {}
+
+    uint16_t get16(const uint8_t* p) const {
+        return littleEndian_ ? static_cast<uint16_t>(p[0] | p[1] << 8) : static_cast<uint16_t>(p[0] << 8 | p[1]);
+    }
+    uint32_t get32(const uint8_t* p) const {
+        return littleEndian_ ? (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24)
+                             : (uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]));
+    }
+
+    // Walk the IFD at offset (relative to the TIFF header): onEntry(tag, type, count, entry, entryOffset)
+    // for each 12-byte directory entry, entryOffset being where it is relative to the TIFF header
+    template <typename ReadAt, typename OnEntry>
+    bool walkIfd(ReadAt& readAt, uint32_t offset, OnEntry&& onEntry) const {
+        static constexpr uint16_t kMaxEntries = 512;
+        uint8_t countBytes[2];
+        if (!inRange(offset, 2) || !readAt(base_ + offset, countBytes, 2)) return false;
+        uint16_t count = get16(countBytes);
+        if (count == 0 || count > kMaxEntries || !inRange(uint64_t(offset) + 2, uint64_t(count) * 12)) return false;
+        uint8_t entries[kMaxEntries * 12];
+        if (!readAt(base_ + offset + 2, entries, size_t(count) * 12)) return false;
+        for (uint16_t i = 0; i < count; ++i) {
+            const uint8_t* e = entries + size_t(i) * 12;
+            if (!onEntry(get16(e), get16(e + 2), get32(e + 4), e, uint64_t(offset) + 2 + uint64_t(i) * 12)) return false;
+        }
+        return true;
+    }
+
+    // ASCII value of a directory entry; false if the entry is not a sane ASCII string
+    template <typename ReadAt>
+    bool readAscii(ReadAt& readAt, uint16_t type, uint32_t count, const uint8_t* entry, uint64_t entryOffset,
+                   ExifTimeTag& tag) const {
+        static constexpr uint16_t kAscii = 2;
+        static constexpr uint32_t kMaxLength = 64;
+        if (type != kAscii || count == 0 || count > kMaxLength) return false;
+        char text[kMaxLength];
+        uint64_t at = entryOffset + 8;  // Values of up to 4 bytes are stored in the entry itself
+        if (count <= 4) {
+            std::memcpy(text, entry + 8, count);
+        } else {
+            at = get32(entry + 8);
+            if (!inRange(at, count) || !readAt(base_ + at, reinterpret_cast<uint8_t*>(text), count)) return false;
+        }
+        tag.present = true;
+        tag.value.assign(text, strnlen(text, count));
+        tag.fileOffset = base_ + at;
+        tag.count = count;
+        return true;
+    }
+
+    bool inRange(uint64_t offset, uint64_t n) const { return offset <= length_ && n <= length_ - offset; }
+
+private:
+    uint64_t base_;    // File offset of the TIFF header
+    uint64_t length_;  // Bytes of TIFF data from base_ (the APP1 payload, or the whole file)
+    bool littleEndian_;
+};
+
+// IFD0 DateTime and the Exif sub-IFD's DateTimeOriginal / DateTimeDigitized / OffsetTimeOriginal of
+// the TIFF structure at base
+template <typename ReadAt>
+ExifReadStatus readTiffTimeTags(ReadAt& readAt, uint64_t base, uint64_t length, ExifTimeTags& out) {
+    uint8_t header[8];
+    if (length < 8 || !readAt(base, header, 8)) return ExifReadStatus::Unsupported;
+    const bool littleEndian = header[0] == 'I' && header[1] == 'I';
+    if (!littleEndian && !(header[0] == 'M' && header[1] == 'M')) return ExifReadStatus::Unsupported;
+    TiffWalker tiff(base, length, littleEndian);
+    if (tiff.get16(header + 2) != 42) return ExifReadStatus::Unsupported;
+
+    uint32_t exifIfdOffset = 0;
+    bool ok = tiff.walkIfd(readAt, tiff.get32(header + 4),
+        [&](uint16_t tag, uint16_t type, uint32_t count, const uint8_t* entry, uint64_t entryOffset) {
+            static constexpr uint16_t kDateTime = 0x0132, kExifIfdPointer = 0x8769, kLong = 4, kIfd = 13;
+            if (tag == kDateTime) return tiff.readAscii(readAt, type, count, entry, entryOffset, out.dateTime);
+            if (tag == kExifIfdPointer) {
+                if ((type != kLong && type != kIfd) || count != 1) return false;
+                exifIfdOffset = tiff.get32(entry + 8);
+            }
+            return true;
+        });
+    if (!ok) return ExifReadStatus::Unsupported;
+    if (exifIfdOffset == 0) return ExifReadStatus::Ok;
+    ok = tiff.walkIfd(readAt, exifIfdOffset,
+        [&](uint16_t tag, uint16_t type, uint32_t count, const uint8_t* entry, uint64_t entryOffset) {
+            static constexpr uint16_t kDateTimeOriginal = 0x9003, kDateTimeDigitized = 0x9004, kOffsetTimeOriginal = 0x9011;
+            if (tag == kDateTimeOriginal) return tiff.readAscii(readAt, type, count, entry, entryOffset, out.dateTimeOriginal);
+            if (tag == kDateTimeDigitized) return tiff.readAscii(readAt, type, count, entry, entryOffset, out.dateTimeDigitized);
+            if (tag == kOffsetTimeOriginal) return tiff.readAscii(readAt, type, count, entry, entryOffset, out.offsetTimeOriginal);
+            return true;
+        });
+    return ok ? ExifReadStatus::Ok : ExifReadStatus::Unsupported;
+}
+
+}  // namespace detail
+
+// Time tags of a JPEG or TIFF-based file of fileSize bytes. readAt(offset, dst, n) must fill dst
+// with n bytes at offset and return false if it cannot.
+template <typename ReadAt>
+ExifReadStatus readExifTimeTags(ReadAt&& readAt, uint64_t fileSize, ExifTimeTags& out) {
+    out = ExifTimeTags{};
+    uint8_t head[4];
+    if (fileSize < 8 || !readAt(0, head, 4)) return ExifReadStatus::Unsupported;
+    if ((head[0] == 'I' && head[1] == 'I' && head[2] == 42 && head[3] == 0)
+        || (head[0] == 'M' && head[1] == 'M' && head[2] == 0 && head[3] == 42))
+        return detail::readTiffTimeTags(readAt, 0, fileSize, out);
+    if (head[0] != 0xFF || head[1] != 0xD8) return ExifReadStatus::Unsupported;
+
+    // JPEG: marker segments up to the first scan; the first APP1 that starts with "Exif\0\0" holds
+    // the TIFF structure
+    static constexpr int kMaxSegments = 64;
+    uint64_t pos = 2;
+    for (int segments = 0; segments < kMaxSegments && pos + 4 <= fileSize; ++segments) {
+        uint8_t marker[4];
+        if (!readAt(pos, marker, 4) || marker[0] != 0xFF) return ExifReadStatus::Unsupported;
+        if (marker[1] == 0xFF) {  // Fill byte
+            ++pos;
+            continue;
+        }
+        if (marker[1] == 0xDA || marker[1] == 0xD9) return ExifReadStatus::NoExif;  // Start of scan / end of image
+        if ((marker[1] >= 0xD0 && marker[1] <= 0xD7) || marker[1] == 0x01) {        // No length
+            pos += 2;
+            continue;
+        }
+        const uint16_t length = static_cast<uint16_t>(marker[2] << 8 | marker[3]);
+        if (length < 2 || pos + 2 + length > fileSize) return ExifReadStatus::Unsupported;
+        uint8_t signature[6];
+        if (marker[1] == 0xE1 && length >= 8 + 8 && readAt(pos + 4, signature, 6)
+            && std::memcmp(signature, "Exif\0\0", 6) == 0)
+            return detail::readTiffTimeTags(readAt, pos + 10, length - 8u, out);
+        pos += 2 + length;
+    }
+    return ExifReadStatus::Unsupported;
+}
+
+// Earliest of DateTimeOriginal / DateTimeDigitized / DateTime as strings ("" if none), the order
+// getExifTimeEarliest has always used
+inline std::string earliestExifTime(const ExifTimeTags& tags) {
+    std::string earliest;
+    for (const ExifTimeTag* tag : { &tags.dateTimeOriginal, &tags.dateTimeDigitized, &tags.dateTime }) {
+        if (tag->present && (earliest.empty() || tag->value < earliest)) earliest = tag->value;
+    }
+    return earliest;
+}
+
+}  // namespace filetimefixer
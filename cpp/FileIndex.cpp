@@ -0,0 +1,213 @@
+#include "FileIndex.h"
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace filetimefixer {
+
+namespace {
+
+// Layout (little-endian): "FTFINDEX", u32 version, u32 zone name length, zone name,
+// u64 pattern hash, u64 count, then per entry
+// u64 device, u64 inode, u64 size, i64 mtimeNs, u8 flags (1 name, 2 exif, 4 file time),
+// i64 target epochMs, u8 target precision, i32 target offsetMinutes.
+const char kIndexMagic[8] = { 'F', 'T', 'F', 'I', 'N', 'D', 'E', 'X' };
+const uint32_t kIndexVersion = 3;
+const uint32_t kMaxZoneNameLength = 4096;
+
+void putU32(std::string& buf, uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void putU64(std::string& buf, uint64_t v) {
+    for (int i = 0; i < 8; ++i) buf += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+bool getU32(std::istream& in, uint32_t& v) {
+    unsigned char b[4];
+    if (!in.read(reinterpret_cast<char*>(b), 4)) return false;
+    v = static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8)
+        | (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    return true;
+}
+
+bool getU64(std::istream& in, uint64_t& v) {
+    unsigned char b[8];
+    if (!in.read(reinterpret_cast<char*>(b), 8)) return false;
+    v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | b[i];
+    return true;
+}
+
+}  // namespace
+
+bool statFileKey(const fs::path& path, FileKey& key) {
+#ifdef _WIN32
+    HANDLE h = CreateFileW(path.wstring().c_str(), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+    if (!ok) return false;
+    key.device = info.dwVolumeSerialNumber;
+    key.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    key.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    key.mtimeNs = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32)
+        | info.ftLastWriteTime.dwLowDateTime) * 100;
+    return true;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    key.device = static_cast<uint64_t>(st.st_dev);
+    key.inode = static_cast<uint64_t>(st.st_ino);
+    key.size = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+    key.mtimeNs = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    key.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    return true;
+#endif
+}
+
+bool FileIndex::load(const fs::path& indexPath, const FileIndexSettings& settings, std::string& error) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    previous_.clear();
+    settings_ = settings;
+    std::ifstream in(indexPath, std::ios::in | std::ios::binary);
+    if (!in) return true;  // First run: start empty
+    char magic[sizeof(kIndexMagic)];
+    uint32_t version = 0;
+    uint64_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != std::string(kIndexMagic, sizeof(kIndexMagic))) {
+        error = "Not a FileTimeFixer index file";
+        return false;
+    }
+    if (!getU32(in, version)) {
+        error = "Truncated index header";
+        return false;
+    }
+    if (version != kIndexVersion) {
+        // Written by another version: start empty, the next save rebuilds it
+        error = "index version " + std::to_string(version) + " is not supported, rebuilding";
+        return true;
+    }
+    FileIndexSettings written;
+    uint32_t zoneLength = 0;
+    if (!getU32(in, zoneLength) || zoneLength > kMaxZoneNameLength) {
+        error = "Truncated index header";
+        return false;
+    }
+    written.timeZone.resize(zoneLength);
+    if ((zoneLength > 0 && !in.read(&written.timeZone[0], zoneLength)) || !getU64(in, written.patternHash)
+        || !getU64(in, count)) {
+        error = "Truncated index header";
+        return false;
+    }
+    if (!(written == settings)) {
+        // Target times were resolved for another zone or pattern set: rebuild like a version change
+        error = written.timeZone != settings.timeZone
+            ? "index was written for time zone " + written.timeZone + ", rebuilding"
+            : "index was written with other --patterns, rebuilding";
+        return true;
+    }
+    previous_.reserve(static_cast<size_t>(std::min<uint64_t>(count, 1u << 24)));
+    for (uint64_t i = 0; i < count; ++i) {
+        FileKey key;
+        uint64_t mtime = 0;
+        char flags = 0;
+        if (!getU64(in, key.device) || !getU64(in, key.inode) || !getU64(in, key.size) || !getU64(in, mtime)
+            || !in.get(flags)) {
+            error = "Truncated index entry";
+            previous_.clear();
+            return false;
+        }
+        FileIndexEntry entry;
+        uint64_t epochMs = 0;
+        char precision = 0;
+        uint32_t offset = 0;
+        bool ok = getU64(in, epochMs) && in.get(precision) && getU32(in, offset)
+            && static_cast<uint8_t>(precision) <= static_cast<uint8_t>(TimePrecision::Milliseconds);
+        entry.targetTime.epochMs = static_cast<int64_t>(epochMs);
+        entry.targetTime.precision = static_cast<TimePrecision>(precision);
+        entry.targetTime.offsetMinutes = static_cast<int16_t>(static_cast<int32_t>(offset));
+        if (!ok) {
+            error = "Corrupt index entry";
+            previous_.clear();
+            return false;
+        }
+        key.mtimeNs = static_cast<int64_t>(mtime);
+        entry.nameOk = (flags & 1) != 0;
+        entry.exifOk = (flags & 2) != 0;
+        entry.fileTimeOk = (flags & 4) != 0;
+        previous_.emplace(key, std::move(entry));
+    }
+    return true;
+}
+
+bool FileIndex::save(const fs::path& indexPath) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    fs::path tmpPath = indexPath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        std::string buf(kIndexMagic, sizeof(kIndexMagic));
+        putU32(buf, kIndexVersion);
+        putU32(buf, static_cast<uint32_t>(settings_.timeZone.size()));
+        buf += settings_.timeZone;
+        putU64(buf, settings_.patternHash);
+        putU64(buf, current_.size());
+        for (const auto& [key, entry] : current_) {
+            putU64(buf, key.device);
+            putU64(buf, key.inode);
+            putU64(buf, key.size);
+            putU64(buf, static_cast<uint64_t>(key.mtimeNs));
+            buf += static_cast<char>((entry.nameOk ? 1 : 0) | (entry.exifOk ? 2 : 0) | (entry.fileTimeOk ? 4 : 0));
+            putU64(buf, static_cast<uint64_t>(entry.targetTime.epochMs));
+            buf += static_cast<char>(entry.targetTime.precision);
+            putU32(buf, static_cast<uint32_t>(static_cast<int32_t>(entry.targetTime.offsetMinutes)));
+            if (buf.size() >= (1 << 20)) {
+                out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+                buf.clear();
+            }
+        }
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        if (!out.flush()) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, indexPath, ec);
+    return !ec;
+}
+
+bool FileIndex::isNormalized(const FileKey& key) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = previous_.find(key);
+    if (it == previous_.end()) return false;
+    const FileIndexEntry& e = it->second;
+    if (!(e.nameOk && e.exifOk && e.fileTimeOk)) return false;
+    current_[key] = e;
+    return true;
+}
+
+void FileIndex::record(const FileKey& key, const FileIndexEntry& entry) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    current_[key] = entry;
+}
+
+void FileIndex::retainLoaded() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    current_.insert(previous_.begin(), previous_.end());  // Entries recorded this run win
+}
+
+size_t FileIndex::currentCount() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return current_.size();
+}
+
+}  // namespace filetimefixer
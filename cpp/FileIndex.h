@@ -0,0 +1,86 @@
+#pragma once
+
+#include "TimeValue.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+// Identity of one file version: same device/inode with same size and mtime means unchanged content.
+struct FileKey {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+
+    bool operator==(const FileKey& o) const {
+        return device == o.device && inode == o.inode && size == o.size && mtimeNs == o.mtimeNs;
+    }
+};
+
+struct FileKeyHash {
+    size_t operator()(const FileKey& k) const {
+        uint64_t h = k.inode * 0x9E3779B97F4A7C15ULL;
+        h ^= k.device + 0x7F4A7C15ULL + (h << 6) + (h >> 2);
+        h ^= k.size + (h << 6) + (h >> 2);
+        h ^= static_cast<uint64_t>(k.mtimeNs) + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+// One stat (POSIX stat / Windows GetFileInformationByHandle). Returns false if the file cannot be read.
+bool statFileKey(const fs::path& path, FileKey& key);
+
+// What the target times of an index were resolved with. An index written with other settings is
+// not used: a file normalized for another --tz or --patterns has another target.
+struct FileIndexSettings {
+    std::string timeZone;      // Name of the --tz zone
+    uint64_t patternHash = 0;  // FileNamePatternSet::fingerprint() of --patterns, 0 without
+
+    bool operator==(const FileIndexSettings& o) const {
+        return timeZone == o.timeZone && patternHash == o.patternHash;
+    }
+};
+
+struct FileIndexEntry {
+    TimeValue targetTime;     // Resolved target time written to the file
+    bool nameOk = false;      // Name is IMG_/VID_<target>
+    bool exifOk = false;      // EXIF / creation_time written
+    bool fileTimeOk = false;  // mtime set to target time
+};
+
+/// Persistent index of files normalized by earlier runs (--index FILE). A file whose key is in
+/// the index with all flags set is skipped without opening it. Only entries seen in the current
+/// run are saved, so deleted files drop out. Thread-safe.
+class FileIndex {
+public:
+    /// Load from disk; a missing file, or one written by another index version or with other
+    /// settings, gives an empty index (error then says why, and the next save rebuilds it).
+    /// Returns false on a corrupt file.
+    bool load(const fs::path& indexPath, const FileIndexSettings& settings, std::string& error);
+    /// Write atomically (temp file + rename), with the settings given to load().
+    bool save(const fs::path& indexPath) const;
+
+    /// True if the file was fully normalized by an earlier run and has not changed since.
+    bool isNormalized(const FileKey& key);
+    void record(const FileKey& key, const FileIndexEntry& entry);
+    /// Keep every loaded entry on save, not only those seen this run (for --watch, which only
+    /// sees the files that change).
+    void retainLoaded();
+
+    size_t loadedCount() const { return previous_.size(); }
+    size_t currentCount() const;
+
+private:
+    mutable std::mutex mutex_;
+    FileIndexSettings settings_;
+    std::unordered_map<FileKey, FileIndexEntry, FileKeyHash> previous_;  // From disk
+    std::unordered_map<FileKey, FileIndexEntry, FileKeyHash> current_;   // Seen or written this run
+};
+
+}  // namespace filetimefixer
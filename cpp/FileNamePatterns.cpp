@@ -0,0 +1,279 @@
+#include "FileNamePatterns.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+namespace filetimefixer {
+
+namespace {
+
+const size_t kMaxPatternLength = 64;
+const size_t kMaxStates = 65536;
+
+std::shared_ptr<const FileNamePatternSet> g_userPatterns;
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+std::bitset<256> digitSet() {
+    std::bitset<256> set;
+    for (int c = '0'; c <= '9'; ++c) set.set(static_cast<size_t>(c));
+    return set;
+}
+
+}  // namespace
+
+bool FileNamePatternSet::add(const std::string& name, const std::string& pattern, std::string& error) {
+    struct FieldSpec {
+        const char* token;
+        Field field;
+        uint8_t width;
+    };
+    static const FieldSpec kFields[] = {
+        { "Y4", Field::Year, 4 },   { "M2", Field::Month, 2 },  { "D2", Field::Day, 2 },
+        { "h2", Field::Hour, 2 },   { "m2", Field::Minute, 2 }, { "s2", Field::Second, 2 },
+        { "ms3", Field::Millis, 3 },
+    };
+
+    Pattern p;
+    p.name = name.empty() ? pattern : name;
+    p.text = pattern;
+    unsigned seen = 0;  // Bit per Field
+    auto literal = [&p](char c) {
+        std::bitset<256> set;
+        set.set(static_cast<unsigned char>(c));
+        p.elements.push_back(set);
+    };
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '}') {
+            if (i + 1 >= pattern.size() || pattern[i + 1] != '}') {
+                error = "unmatched '}' in pattern: " + pattern;
+                return false;
+            }
+            literal(c);
+            ++i;
+            continue;
+        }
+        if (c != '{') {
+            literal(c);
+            continue;
+        }
+        if (i + 1 < pattern.size() && pattern[i + 1] == '{') {
+            literal(c);
+            ++i;
+            continue;
+        }
+        size_t close = pattern.find('}', i);
+        if (close == std::string::npos) {
+            error = "unterminated '{' in pattern: " + pattern;
+            return false;
+        }
+        std::string token = pattern.substr(i + 1, close - i - 1);
+        i = close;
+        if (token == "#") {
+            p.elements.push_back(digitSet());
+            continue;
+        }
+        if (token == "?") {
+            p.elements.push_back(std::bitset<256>().set());
+            continue;
+        }
+        const FieldSpec* spec = nullptr;
+        for (const FieldSpec& f : kFields)
+            if (token == f.token) spec = &f;
+        if (!spec) {
+            error = "unknown field {" + token + "} in pattern: " + pattern;
+            return false;
+        }
+        unsigned bit = 1u << static_cast<unsigned>(spec->field);
+        if (seen & bit) {
+            error = "field {" + token + "} used twice in pattern: " + pattern;
+            return false;
+        }
+        seen |= bit;
+        p.fields.push_back({ spec->field, static_cast<uint8_t>(p.elements.size()), spec->width });
+        for (uint8_t k = 0; k < spec->width; ++k) p.elements.push_back(digitSet());
+    }
+
+    auto has = [seen](Field f) { return (seen & (1u << static_cast<unsigned>(f))) != 0; };
+    if (!has(Field::Year) || !has(Field::Month) || !has(Field::Day)) {
+        error = "pattern needs {Y4}, {M2} and {D2}: " + pattern;
+        return false;
+    }
+    p.hasTime = has(Field::Hour);
+    if (!p.hasTime && (has(Field::Minute) || has(Field::Second) || has(Field::Millis))) {
+        error = "time fields need {h2}: " + pattern;
+        return false;
+    }
+    if (p.elements.size() > kMaxPatternLength) {
+        error = "pattern longer than " + std::to_string(kMaxPatternLength) + " characters: " + pattern;
+        return false;
+    }
+    patterns_.push_back(std::move(p));
+    transitions_.clear();
+    accepts_.clear();
+    return true;
+}
+
+bool FileNamePatternSet::loadFile(const fs::path& file, std::string& error) {
+    std::ifstream in(file);
+    if (!in) {
+        error = "cannot open " + file.string();
+        return false;
+    }
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        std::string name, pattern = line;
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            name = trim(line.substr(0, eq));
+            pattern = trim(line.substr(eq + 1));
+        }
+        std::string lineError;
+        if (!add(name, pattern, lineError)) {
+            error = file.string() + ":" + std::to_string(lineNo) + ": " + lineError;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t FileNamePatternSet::fingerprint() const {
+    uint64_t h = 14695981039346656037ULL;  // FNV-1a
+    for (const Pattern& p : patterns_) {
+        for (unsigned char c : p.text + '\n') {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+bool FileNamePatternSet::compile(std::string& error) {
+    transitions_.clear();
+    accepts_.clear();
+
+    // Byte classes: bytes accepted by exactly the same pattern positions behave identically
+    std::vector<std::bitset<256>> sets;
+    for (const Pattern& p : patterns_)
+        for (const auto& set : p.elements)
+            if (std::find(sets.begin(), sets.end(), set) == sets.end()) sets.push_back(set);
+    std::map<std::vector<bool>, uint8_t> classIds;
+    std::vector<unsigned char> representative;
+    for (unsigned b = 0; b < 256; ++b) {
+        std::vector<bool> signature(sets.size());
+        for (size_t k = 0; k < sets.size(); ++k) signature[k] = sets[k].test(b);
+        auto [it, inserted] = classIds.emplace(signature, static_cast<uint8_t>(representative.size()));
+        if (inserted) representative.push_back(static_cast<unsigned char>(b));
+        classOf_[b] = it->second;
+    }
+    classCount_ = static_cast<unsigned>(representative.size());
+
+    // NFA position (pattern, offset) -> first[pattern] + offset; offset == length means matched
+    std::vector<uint32_t> first, owner;
+    for (size_t p = 0; p < patterns_.size(); ++p) {
+        first.push_back(static_cast<uint32_t>(owner.size()));
+        owner.insert(owner.end(), patterns_[p].elements.size() + 1, static_cast<uint32_t>(p));
+    }
+
+    // Subset construction; every state also holds offset 0 of every pattern (match anywhere)
+    using StateSet = std::vector<uint32_t>;
+    std::map<StateSet, uint32_t> ids;
+    std::vector<StateSet> pending;
+    auto intern = [&](StateSet set) -> uint32_t {
+        auto it = ids.find(set);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(accepts_.size());
+        std::vector<uint32_t> accepted;
+        for (uint32_t pos : set) {
+            uint32_t p = owner[pos];
+            if (pos - first[p] == patterns_[p].elements.size()) accepted.push_back(p);
+        }
+        accepts_.push_back(std::move(accepted));
+        ids.emplace(set, id);
+        pending.push_back(std::move(set));
+        return id;
+    };
+    intern(first);
+
+    for (size_t state = 0; state < pending.size(); ++state) {
+        if (pending.size() > kMaxStates) {
+            error = "filename patterns need more than " + std::to_string(kMaxStates) + " DFA states";
+            transitions_.clear();
+            accepts_.clear();
+            return false;
+        }
+        for (unsigned c = 0; c < classCount_; ++c) {
+            StateSet next = first;
+            for (uint32_t pos : pending[state]) {
+                const Pattern& pat = patterns_[owner[pos]];
+                size_t offset = pos - first[owner[pos]];
+                if (offset < pat.elements.size() && pat.elements[offset].test(representative[c]))
+                    next.push_back(pos + 1);
+            }
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            uint32_t target = intern(std::move(next));
+            transitions_.resize(pending.size() * classCount_);
+            transitions_[state * classCount_ + c] = target;
+        }
+    }
+    return true;
+}
+
+bool FileNamePatternSet::readFields(const Pattern& p, const char* start, FileNameTime& out) const {
+    FileNameTime t;
+    for (const FieldRef& f : p.fields) {
+        int v = 0;
+        for (uint8_t k = 0; k < f.width; ++k) v = v * 10 + (start[f.offset + k] - '0');
+        switch (f.field) {
+        case Field::Year: t.year = v; break;
+        case Field::Month: t.month = v; break;
+        case Field::Day: t.day = v; break;
+        case Field::Hour: t.hour = v; break;
+        case Field::Minute: t.minute = v; break;
+        case Field::Second: t.second = v; break;
+        case Field::Millis:
+            t.millis = v;
+            t.hasMillis = true;
+            break;
+        }
+    }
+    t.hasTime = p.hasTime;
+    if (!isValidFileNameTime(t)) return false;
+    out = t;
+    return true;
+}
+
+bool FileNamePatternSet::match(std::string_view name, FileNameTime& out, int& patternIndex) const {
+    if (accepts_.empty()) return false;
+    uint32_t state = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        state = transitions_[state * classCount_ + classOf_[static_cast<unsigned char>(name[i])]];
+        for (uint32_t p : accepts_[state]) {
+            const Pattern& pat = patterns_[p];
+            if (readFields(pat, name.data() + i + 1 - pat.elements.size(), out)) {
+                patternIndex = static_cast<int>(p);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void setUserFileNamePatterns(std::shared_ptr<const FileNamePatternSet> patterns) {
+    g_userPatterns = std::move(patterns);
+}
+
+const FileNamePatternSet* userFileNamePatterns() {
+    return g_userPatterns.get();
+}
+
+}  // namespace filetimefixer
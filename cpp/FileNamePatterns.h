@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TimeParse.h"
+#include <bitset>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+// User-defined filename layouts (--patterns FILE), e.g.
+//   dji      = DJI_{Y4}{M2}{D2}{h2}{m2}{s2}
+//   whatsapp = IMG-{Y4}{M2}{D2}-WA{#}{#}{#}{#}
+// Fields: {Y4} {M2} {D2} {h2} {m2} {s2} {ms3}; {#} any digit, {?} any character; every other
+// character is literal ("{{" and "}}" for braces). Year, month and day are required; missing
+// time fields are 0, and a pattern without {h2} gives a date only. Every pattern has a fixed
+// length, so a match anywhere in the name is located by its end position alone.
+//
+// All patterns are compiled into one DFA over byte classes, so a name is matched in a single
+// left-to-right pass however many patterns are loaded. The match ending first wins; among
+// patterns ending at the same character the one listed first wins. A match whose fields are not
+// a valid date/time is skipped and the scan continues.
+class FileNamePatternSet {
+public:
+    /// Add one pattern; name may be empty (the pattern text is used). Invalidates compile().
+    bool add(const std::string& name, const std::string& pattern, std::string& error);
+    /// Lines "name = pattern" or "pattern"; blank lines and lines starting with '#' are skipped.
+    bool loadFile(const fs::path& file, std::string& error);
+    /// Build the DFA. Returns false if it would exceed the state limit.
+    bool compile(std::string& error);
+
+    /// Match name; on success out holds the time and patternIndex the winning pattern.
+    bool match(std::string_view name, FileNameTime& out, int& patternIndex) const;
+
+    size_t size() const { return patterns_.size(); }
+    const std::string& patternName(int index) const { return patterns_[static_cast<size_t>(index)].name; }
+    size_t stateCount() const { return accepts_.size(); }
+    /// Hash of the pattern texts in priority order: equal for sets that match names alike
+    uint64_t fingerprint() const;
+
+private:
+    enum class Field : uint8_t { Year, Month, Day, Hour, Minute, Second, Millis };
+    struct FieldRef {
+        Field field;
+        uint8_t offset;
+        uint8_t width;
+    };
+    struct Pattern {
+        std::string name;
+        std::string text;  // As given to add()
+        std::vector<std::bitset<256>> elements;  // Bytes accepted at each position
+        std::vector<FieldRef> fields;
+        bool hasTime = false;
+    };
+
+    bool readFields(const Pattern& p, const char* start, FileNameTime& out) const;
+
+    std::vector<Pattern> patterns_;
+    // DFA: state * classCount_ + class -> state; state 0 is the start state
+    uint8_t classOf_[256] = {};
+    unsigned classCount_ = 0;
+    std::vector<uint32_t> transitions_;
+    std::vector<std::vector<uint32_t>> accepts_;  // Patterns completed on entering each state, in priority order
+};
+
+/// Patterns consulted by parseFileNameTime before the built-in layouts (nullptr: none).
+/// Set once at startup, before any file is processed.
+void setUserFileNamePatterns(std::shared_ptr<const FileNamePatternSet> patterns);
+const FileNamePatternSet* userFileNamePatterns();
+
+}  // namespace filetimefixer
@@ -0,0 +1,252 @@
+#include "FileProcessor.h"
+#include "TimeParse.h"
+#include "TimeConvert.h"
+#include "ExifHelper.h"
+#include "FileTimeHelper.h"
+#include "ImageUtil.h"
+#include "VideoMetaHelper.h"
+#include "RunJournal.h"
+#include "AdaptiveConcurrency.h"
+#include <cstring>
+#include <sstream>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace filetimefixer {
+
+std::string toUtf8ForLog(const std::string& s) {
+#ifdef _WIN32
+    if (s.empty()) return s;
+    int wlen = MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return s;
+    std::wstring wbuf(static_cast<size_t>(wlen), 0);
+    MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, &wbuf[0], wlen);
+    int ulen = WideCharToMultiByte(CP_UTF8, 0, wbuf.c_str(), -1, nullptr, 0, nullptr, nullptr);
+    if (ulen <= 0) return s;
+    std::string out(static_cast<size_t>(ulen), 0);
+    WideCharToMultiByte(CP_UTF8, 0, wbuf.c_str(), -1, &out[0], ulen, nullptr, nullptr);
+    out.resize(static_cast<size_t>(ulen - 1));
+    return out;
+#else
+    return s;
+#endif
+}
+
+namespace {
+
+bool fail(MediaResult& result, const std::string& path, const std::string& message) {
+    result.status = MediaStatus::Error;
+    result.errorPath = path;
+    result.errorMessage = message;
+    return false;
+}
+
+// Run one stage body; Exiv2 / std exceptions become a "[Skip]" error on the file.
+template <typename Fn>
+bool runStage(const MediaTask& task, MediaResult& result, std::ostream& err, Fn&& body) {
+    std::string fileName = task.path.filename().string();
+    try {
+        return body();
+    } catch (const Exiv2::Error& e) {
+        err << "[Skip] Exiv2 error on " << fileName << ": " << e.what() << std::endl;
+        return fail(result, task.path.string(), std::string("Exiv2 error: ") + e.what());
+    } catch (const std::exception& e) {
+        err << "[Skip] Exception on " << fileName << ": " << e.what() << std::endl;
+        return fail(result, task.path.string(), std::string("Exception: ") + e.what());
+    }
+}
+
+bool timedRename(const std::string& from, const std::string& to, std::string& error) {
+    StageTimer timer(IoStage::Rename);
+    return renameFile(from, to, error);
+}
+
+// The source of a replayed plan is gone: it was renamed by an earlier attempt only if the file at
+// the target is the one planned, unchanged or with its file time already at the target. A file
+// that took the freed inode of a deleted source has another mtime.
+bool isPlannedSourceAt(const MediaPlan& plan, const std::string& targetPath) {
+    FileKey target;
+    if (!plan.plannedSource || !statFileKey(targetPath, target)) return false;
+    const FileKey& source = *plan.plannedSource;
+    return target.device == source.device && target.inode == source.inode && target.size == source.size
+        && (target.mtimeNs == source.mtimeNs || fileTimesMatchTarget(targetPath, plan.resolved.targetTime));
+}
+
+}  // namespace
+
+bool readMediaFile(const MediaTask& task, MediaRead& read, MediaResult& result, std::ostream& err) {
+    return runStage(task, result, err, [&] {
+        std::string filePath = task.path.string();
+        read.task = task;
+        read.isImage = isImageFile(task.path);
+        std::string metaTimeRaw, offsetTimeOriginal;
+        if (read.isImage) {
+            StageTimer timer(IoStage::MetadataRead);
+            read.exifSession = std::make_shared<ExifSession>();
+            metaTimeRaw = getExifTimeEarliest(filePath, offsetTimeOriginal, *read.exifSession);
+            if (!read.exifSession->isOpen()) read.exifSession.reset();  // Read natively: nothing to carry
+        } else if (isVideoFile(task.path)) {
+            // Not timed: an ffprobe process takes far longer than the storage it waits on
+            metaTimeRaw = getVideoCreationTimeUtc(filePath);
+        }
+        int offsetMinutes = 0;
+        if (parseUtcOffset(offsetTimeOriginal, offsetMinutes)) read.zoneOverride = TimeZone::fixed(offsetMinutes);
+        FileNameTime nameFields;
+        if (findFileNameTime(task.path.filename().string(), nameFields, read.namePattern))
+            read.nameTime = timeValueFromWall(nameFields, read.zone());
+        read.exifTime = read.isImage ? exifDateTimeToTimeValue(metaTimeRaw, read.zone()) : parseTimeValue(metaTimeRaw, 0);
+        return true;
+    });
+}
+
+bool resolveMediaFile(const MediaRead& read, MediaPlan& plan, MediaResult& result,
+                      std::ostream& out, std::ostream& err) {
+    const MediaTask& task = read.task;
+    return runStage(task, result, err, [&] {
+        std::string filePath = task.path.string();
+        std::string fileName = task.path.filename().string();
+        plan.task = task;
+        plan.isImage = read.isImage;
+        plan.exifSession = read.exifSession;
+        if (!read.isImage) plan.videoCreationTime = read.exifTime;
+        plan.resolved = resolveTargetTime(read.nameTime, read.exifTime, read.zone());
+        ResolveResult& resolved = plan.resolved;
+        if (resolved.targetTime.empty()) {
+            err << "[Ignore] Unable to parse time: " << fileName << std::endl;
+            return fail(result, filePath, "Unable to parse time");
+        }
+        // Named and written on the file's wall clock, also when taken from UTC video metadata
+        resolved.targetTime = inTimeZone(supplementDateWithCurrentUtcTime(resolved.targetTime), read.zone());
+
+        char stem[4 + kNameStemMaxLength];
+        std::memcpy(stem, read.isImage ? "IMG_" : "VID_", 4);
+        size_t stemLength = 4 + formatTimeToLocalName(resolved.targetTime, stem + 4);
+        plan.targetFileName.assign(stem, stemLength).append(task.path.extension().string());
+        out << task.fileIndex << ": " << fileName << " | NameTime: " << formatTimeValue(read.nameTime)
+            << (read.namePattern.empty() ? "" : " (pattern " + read.namePattern + ")")
+            << ", ExifTime: " << formatTimeValue(read.exifTime) << ", TargetTime: " << formatTimeValue(resolved.targetTime)
+            << " [" << scenarioName(resolved.scenario) << "] => " << plan.targetFileName << std::endl;
+        return true;
+    });
+}
+
+MediaResult applyMediaPlan(const MediaPlan& plan, TargetNameClaims& claims, std::ostream& out, std::ostream& err,
+                           RunJournal* journal) {
+    MediaResult result;
+    const MediaTask& task = plan.task;
+    runStage(task, result, err, [&] {
+        std::string filePath = task.path.string();
+        std::string fileName = task.path.filename().string();
+        const ResolveResult& resolved = plan.resolved;
+        bool renamedThisFile = false;
+
+        std::string finalPath = filePath;
+        if (plan.targetFileName != fileName) {
+            std::string newFilePath = task.path.parent_path().string() + "/" + plan.targetFileName;
+            std::string renameError;
+            if (!fs::exists(task.path) && isPlannedSourceAt(plan, newFilePath) && claims.claim(newFilePath)) {
+                out << "Already renamed: " << filePath << " -> " << newFilePath << std::endl;
+                finalPath = newFilePath;
+                renamedThisFile = true;
+            } else if (!claims.claim(newFilePath) || fs::exists(newFilePath)) {
+                err << "Target file already exists: " << newFilePath << std::endl;
+                return fail(result, filePath, "Target file already exists: " + newFilePath);
+            } else if (!timedRename(filePath, newFilePath, renameError)) {
+                err << "Rename failed: " << filePath << " (" << renameError << ")" << std::endl;
+                return fail(result, filePath, "Rename failed: " + renameError);
+            } else {
+                out << "Rename success: " << filePath << " -> " << newFilePath << std::endl;
+                finalPath = newFilePath;
+                renamedThisFile = true;
+                result.renamed = true;
+                if (journal) journal->renamed(plan, newFilePath);
+            }
+        } else {
+            out << "File name already correct: " << filePath << std::endl;
+            ++result.writesAvoided;
+        }
+
+        bool exifOk = true;
+        bool metaAlreadySet = false;
+        std::string exifInfo;
+        if (plan.isImage) {
+            // One open for write and read-back; none at all if the read stage's session came along
+            ExifSession ownSession;
+            ExifSession& session = plan.exifSession ? *plan.exifSession : ownSession;
+            {
+                StageTimer timer(IoStage::MetadataWrite);
+                exifOk = session.writeTime(finalPath, resolved.targetTime, metaAlreadySet);
+            }
+            exifInfo = session.timeInfoString();
+        } else {
+            // creation_time is stored to the second
+            // ffprobe / ffmpeg are not timed for the controller, see readMediaFile
+            std::string currentRaw;
+            if (!plan.videoCreationTime) currentRaw = getVideoCreationTimeUtc(finalPath);
+            const TimeValue current = plan.videoCreationTime ? *plan.videoCreationTime : parseTimeValue(currentRaw, 0);
+            metaAlreadySet = !current.empty() && current.epochSeconds() == resolved.targetTime.epochSeconds();
+            if (metaAlreadySet) {
+                exifInfo = "creation_time=" + timestampToUTCString(static_cast<std::time_t>(resolved.targetTime.epochSeconds()));
+            } else {
+                exifOk = setVideoCreationTime(finalPath, resolved.targetTime);
+                exifInfo = getVideoTimeInfoString(finalPath);
+                if (exifInfo == "(no video metadata)") {
+                    exifInfo = "creation_time=" + timestampToUTCString(static_cast<std::time_t>(resolved.targetTime.epochSeconds()))
+                        + " (target written; read-back unavailable - ensure ffmpeg/ffprobe on PATH)";
+                }
+            }
+        }
+        // After the metadata step, which changes the file's mtime whenever it writes
+        bool fileTimeOk;
+        bool fileTimeAlreadySet;
+        std::string fileTimeError;
+        {
+            StageTimer timer(IoStage::FileTime);
+            fileTimeAlreadySet = fileTimesMatchTarget(fs::path(finalPath), resolved.targetTime);
+            fileTimeOk = fileTimeAlreadySet
+                || setFileTimesToTargetTime(fs::path(finalPath), resolved.targetTime, fileTimeError);
+        }
+        result.writesAvoided += (metaAlreadySet ? 1 : 0) + (fileTimeAlreadySet ? 1 : 0);
+        if (metaAlreadySet || fileTimeAlreadySet) {
+            out << "  [Skip write] " << (metaAlreadySet ? (plan.isImage ? "EXIF" : "creation_time") : "")
+                << (metaAlreadySet && fileTimeAlreadySet ? ", " : "") << (fileTimeAlreadySet ? "file time" : "")
+                << " already at target" << std::endl;
+        }
+        if (plan.isImage)
+            out << "  [EXIF after fix] " << exifInfo << std::endl;
+        else
+            out << "  [Video metadata after fix] " << exifInfo << std::endl;
+        if (!fileTimeOk) {
+            err << "File time modification failed: " << finalPath << " (" << fileTimeError << ")" << std::endl;
+            fail(result, finalPath, "File time modification failed: " + fileTimeError);
+        } else {
+            result.status = renamedThisFile ? MediaStatus::Success : MediaStatus::Unchanged;
+        }
+        result.finalPath = finalPath;
+        result.exifOk = exifOk;
+        result.metadataWritten = exifOk && !metaAlreadySet;
+        result.fileTimeOk = fileTimeOk;
+        const char* metaLabel = plan.isImage ? "EXIF after fix" : "Video metadata after fix";
+        std::ostringstream entry;
+        entry << task.logSeq << ". File: " << toUtf8ForLog(finalPath) << "\n  TargetTime: " << formatTimeValue(resolved.targetTime)
+              << "  EXIF_ok: " << (exifOk ? "yes" : "no")
+              << "  FileTime_ok: " << (fileTimeOk ? "yes" : "no")
+              << "\n  [" << metaLabel << "] " << toUtf8ForLog(exifInfo) << "\n";
+        result.logEntry = entry.str();
+        if (journal && fileTimeOk) journal->done(filePath, finalPath);
+        return fileTimeOk;
+    });
+    return result;
+}
+
+MediaResult processMediaFile(const MediaTask& task, TargetNameClaims& claims, std::ostream& out, std::ostream& err) {
+    MediaResult result;
+    MediaRead read;
+    if (!readMediaFile(task, read, result, err)) return result;
+    MediaPlan plan;
+    if (!resolveMediaFile(read, plan, result, out, err)) return result;
+    return applyMediaPlan(plan, claims, out, err);
+}
+
+}  // namespace filetimefixer
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "FileIndex.h"
+#include "TargetTimeResolver.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+class ExifSession;
+class RunJournal;
+
+// One media file found during directory traversal.
+struct MediaTask {
+    fs::path path;
+    int fileIndex = 0;  // totalFileCount at the time the file was found (console prefix)
+    int logSeq = 0;     // Sequence number in log (1-based)
+};
+
+// Read stage output: times taken from the filename and from EXIF / video metadata.
+struct MediaRead {
+    MediaTask task;
+    bool isImage = false;
+    TimeValue nameTime;
+    std::string namePattern;  // User pattern that produced nameTime ("" for a built-in layout)
+    TimeValue exifTime;       // EXIF (wall clock of zone()) or video creation_time (UTC)
+    std::optional<TimeZone> zoneOverride;  // From EXIF OffsetTimeOriginal
+    std::shared_ptr<ExifSession> exifSession;  // Exiv2 read of an image (null if read natively), reused to write
+
+    // Zone of this file's wall-clock times: OffsetTimeOriginal if present, else --tz
+    const TimeZone& zone() const { return zoneOverride ? *zoneOverride : localTimeZone(); }
+};
+
+// Resolve stage output: everything the write stage needs, no file has been touched yet.
+struct MediaPlan {
+    MediaTask task;
+    bool isImage = false;
+    ResolveResult resolved;
+    std::string targetFileName;
+    std::shared_ptr<ExifSession> exifSession;  // From the read stage; null for plans read from a file
+    std::optional<TimeValue> videoCreationTime;  // Video creation_time as read; unset for plans read from a file
+    std::optional<FileKey> plannedSource;  // Source identity when the plan was written; only for plans read by --apply
+};
+
+enum class MediaStatus { Success, Unchanged, Planned, Error };
+
+struct MediaResult {
+    MediaStatus status = MediaStatus::Error;
+    std::string errorPath;
+    std::string errorMessage;
+    std::string logEntry;  // Empty when the file did not reach the write stage
+    std::string finalPath; // Path after rename (set by the write stage)
+    bool exifOk = false;     // EXIF / creation_time written
+    bool fileTimeOk = false; // File time set
+    bool renamed = false;          // Renamed by this call (not found already renamed)
+    bool metadataWritten = false;  // EXIF / creation_time written by this call (not already at the target)
+    int writesAvoided = 0;   // Rename / metadata / file time steps skipped because already at the target
+};
+
+// Target names claimed during this run, so two files resolving to the same name in parallel
+// cannot both pass the exists() check and overwrite each other.
+class TargetNameClaims {
+public:
+    bool claim(const std::string& path) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return claimed_.insert(path).second;
+    }
+private:
+    std::mutex mutex_;
+    std::unordered_set<std::string> claimed_;
+};
+
+// On Windows convert ACP string to UTF-8 for log file; on other platforms return as-is.
+std::string toUtf8ForLog(const std::string& s);
+
+// Stage 1: parseFileNameTime + getExifTimeEarliest / getVideoCreationTimeUtc.
+// Returns false (result holds the error) on failure. Never throws.
+bool readMediaFile(const MediaTask& task, MediaRead& read, MediaResult& result, std::ostream& err);
+
+// Stage 2: resolveTargetTime and target filename. Returns false (result holds the error) on failure.
+bool resolveMediaFile(const MediaRead& read, MediaPlan& plan, MediaResult& result,
+                      std::ostream& out, std::ostream& err);
+
+// Stage 3: renameFile, modifyExifDataForTime / setVideoCreationTime, setFileTimesToTargetTime.
+// Each step is skipped when the file already holds its target (name, all three EXIF tags, video
+// creation_time, file times), so re-running over fixed files writes nothing.
+// If a plan replayed by --apply finds its source gone and the very same file at the target name
+// (device, inode, size, and mtime unless already at the target), the rename is treated as done
+// and the metadata / file time steps still run; any other file at the target name is a conflict.
+// With a journal, the rename and the finished file are recorded so an interrupted run can be resumed.
+MediaResult applyMediaPlan(const MediaPlan& plan, TargetNameClaims& claims, std::ostream& out, std::ostream& err,
+                           RunJournal* journal = nullptr);
+
+// All three stages in order for one file. Console output goes to out/err so parallel runs
+// can print each file's lines as one block.
+MediaResult processMediaFile(const MediaTask& task, TargetNameClaims& claims, std::ostream& out, std::ostream& err);
+
+}  // namespace filetimefixer
@@ -1,6 +1,9 @@
-#include "TimeConvert.h"
 #include "FileTimeHelper.h"
+#include "IoBudget.h"
+#include <cerrno>
 #include <chrono>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <sys/stat.h>
 #ifdef _WIN32
@@ -15,38 +18,15 @@
 
 namespace filetimefixer {
 
-// Target time string is Beijing (UTC+8). Convert to UTC time_t for file system.
-static std::time_t targetTimeToUtcTimestamp(const std::tm& tm) {
-    std::time_t utc;
-#if defined(_WIN32)
-    utc = _mkgmtime(const_cast<std::tm*>(&tm));
-#else
-    char* tz = std::getenv("TZ");
-    setenv("TZ", "UTC", 1);
-    tzset();
-    utc = std::mktime(const_cast<std::tm*>(&tm));
-    if (tz) setenv("TZ", tz, 1); else unsetenv("TZ");
-    tzset();
-#endif
-    if (utc == static_cast<std::time_t>(-1)) return utc;
-    return utc - 8 * 3600;  // Beijing -> UTC
-}
-
-bool setFileTimesToTargetTime(const fs::path& filepath, const std::string& timeStr) {
-    std::tm tm = {};
-    if (!parseUTCStringToTm(tm, timeStr)) {
-        std::cerr << "Failed to parse time string: " << timeStr << std::endl;
-        return false;
-    }
-    tm.tm_isdst = 0;
-    std::time_t timestamp = targetTimeToUtcTimestamp(tm);
-    if (timestamp == static_cast<std::time_t>(-1)) {
-        std::cerr << "Failed to convert time: " << timeStr << std::endl;
+bool setFileTimesToTargetTime(const fs::path& filepath, const TimeValue& targetTime, std::string& error) {
+    if (targetTime.empty()) {
+        error = "no target time";
         return false;
     }
+    chargeMetadataOps();
 #if defined(_WIN32)
     FILETIME ftCreate, ftAccess, ftWrite;
-    LONGLONG ll = Int32x32To64(timestamp, 10000000) + 116444736000000000LL;
+    LONGLONG ll = static_cast<LONGLONG>(targetTime.epochSeconds()) * 10000000LL + 116444736000000000LL;
     ftCreate.dwLowDateTime = (DWORD)ll;
     ftCreate.dwHighDateTime = (DWORD)(ll >> 32);
     ftAccess = ftWrite = ftCreate;
@@ -55,25 +35,52 @@ bool setFileTimesToTargetTime(const fs::path& filepath, const std::string& timeS
         FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
         FILE_ATTRIBUTE_NORMAL, NULL);
     if (hFile == INVALID_HANDLE_VALUE) {
-        std::cerr << "Windows CreateFile failed: " << GetLastError() << std::endl;
+        error = "CreateFile failed: " + std::to_string(GetLastError());
         return false;
     }
     BOOL result = SetFileTime(hFile, &ftCreate, &ftAccess, &ftWrite);
+    DWORD lastError = GetLastError();
     CloseHandle(hFile);
     if (!result) {
-        std::cerr << "SetFileTime failed: " << GetLastError() << std::endl;
+        error = "SetFileTime failed: " + std::to_string(lastError);
         return false;
     }
 #else
-    auto sys_time = std::chrono::system_clock::from_time_t(timestamp);
-    auto sys_duration = sys_time.time_since_epoch();
-    auto file_duration = std::chrono::duration_cast<fs::file_time_type::duration>(sys_duration);
-    fs::file_time_type file_time(file_duration);
-    fs::last_write_time(filepath, file_time);
+    // file_time_type has its own epoch (2174 on libstdc++); convert through the clock, not the raw count
+    auto sys_time = std::chrono::sys_seconds(std::chrono::seconds(targetTime.epochSeconds()));
+    fs::file_time_type file_time = std::chrono::time_point_cast<fs::file_time_type::duration>(
+        fs::file_time_type::clock::from_sys(sys_time));
+    std::error_code ec;
+    fs::last_write_time(filepath, file_time, ec);
+    if (ec) {
+        error = ec.message();
+        return false;
+    }
 #endif
     return true;
 }
 
+bool fileTimesMatchTarget(const fs::path& filepath, const TimeValue& targetTime) {
+    if (targetTime.empty()) return false;
+    chargeMetadataOps();
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(filepath.wstring().c_str(), GetFileExInfoStandard, &attributes)) return false;
+    LONGLONG ll = static_cast<LONGLONG>(targetTime.epochSeconds()) * 10000000LL + 116444736000000000LL;
+    auto isTarget = [ll](const FILETIME& ft) {
+        return ft.dwLowDateTime == (DWORD)ll && ft.dwHighDateTime == (DWORD)(ll >> 32);
+    };
+    return isTarget(attributes.ftCreationTime) && isTarget(attributes.ftLastWriteTime);
+#else
+    std::error_code ec;
+    fs::file_time_type file_time = fs::last_write_time(filepath, ec);
+    if (ec) return false;
+    auto sys_time = std::chrono::sys_seconds(std::chrono::seconds(targetTime.epochSeconds()));
+    return file_time == std::chrono::time_point_cast<fs::file_time_type::duration>(
+        fs::file_time_type::clock::from_sys(sys_time));
+#endif
+}
+
 void printPosixFileTimes(const std::string& filename) {
     struct stat fileStat;
     if (stat(filename.c_str(), &fileStat) != 0) return;
@@ -82,20 +89,21 @@ void printPosixFileTimes(const std::string& filename) {
               << "Metadata modification time: " << ctime(&fileStat.st_ctime);
 }
 
-bool renameFile(const std::string& oldName, const std::string& newName) {
+bool renameFile(const std::string& oldName, const std::string& newName, std::string& error) {
     if (access(oldName.c_str(), F_OK) != 0) {
-        std::cerr << "File not exist: " << oldName << std::endl;
+        error = "file does not exist";
         return false;
     }
     if (oldName == newName) {
-        std::cerr << "New name is the same as old name!" << std::endl;
+        error = "new name is the same as old name";
         return false;
     }
-    if (rename(oldName.c_str(), newName.c_str()) == 0) {
-        std::cout << "Rename success: " << oldName << " -> " << newName << std::endl;
-        return true;
+    chargeMetadataOps();
+    if (rename(oldName.c_str(), newName.c_str()) != 0) {
+        error = std::strerror(errno);
+        return false;
     }
-    return false;
+    return true;
 }
 
 }  // namespace filetimefixer
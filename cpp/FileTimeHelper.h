@@ -1,5 +1,6 @@
 #pragma once
 
+#include "TimeValue.h"
 #include <filesystem>
 #include <string>
 
@@ -7,11 +8,15 @@ namespace fs = std::filesystem;
 
 namespace filetimefixer {
 
-// Set file creation/access/modification time (Windows) or mtime (Linux/Mac) to UTC corresponding to timeStr
-bool setFileTimesToTargetTime(const fs::path& filepath, const std::string& timeStr);
+// Set file creation/access/modification time (Windows) or mtime (Linux/Mac) to targetTime.
+// Prints nothing (it runs on worker threads); on failure error says why.
+bool setFileTimesToTargetTime(const fs::path& filepath, const TimeValue& targetTime, std::string& error);
+// The times setFileTimesToTargetTime sets already hold exactly targetTime
+bool fileTimesMatchTarget(const fs::path& filepath, const TimeValue& targetTime);
 
 void printPosixFileTimes(const std::string& filename);
 
-bool renameFile(const std::string& oldName, const std::string& newName);
+// Prints nothing, like setFileTimesToTargetTime; on failure error says why.
+bool renameFile(const std::string& oldName, const std::string& newName, std::string& error);
 
 }  // namespace filetimefixer
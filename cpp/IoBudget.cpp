@@ -0,0 +1,234 @@
+#include "IoBudget.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace filetimefixer {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+const uint64_t kHeaderReadBytes = 64 * 1024;  // EXIF / moov header region a metadata read touches
+
+class TokenBucket {
+public:
+    void setRate(double perSecond) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        bool wasUnlimited = rate_ <= 0;
+        rate_ = perSecond > 0 ? perSecond : 0;
+        tokens_ = wasUnlimited ? rate_ : std::min(tokens_, rate_);  // Start with a full bucket
+        last_ = Clock::now();
+    }
+
+    // Burst is one second worth of tokens; a larger charge goes into debt and the caller
+    // (and anyone after it) sleeps until it is paid back.
+    void acquire(double amount) {
+        double waitSeconds = 0;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (rate_ <= 0) return;
+            auto now = Clock::now();
+            tokens_ = std::min(rate_, tokens_ + rate_ * Seconds(now - last_).count());
+            last_ = now;
+            tokens_ -= amount;
+            if (tokens_ < 0) waitSeconds = -tokens_ / rate_;
+        }
+        if (waitSeconds > 0) std::this_thread::sleep_for(Seconds(waitSeconds));
+    }
+
+private:
+    std::mutex mutex_;
+    double rate_ = 0;
+    double tokens_ = 0;
+    Clock::time_point last_ = Clock::now();
+};
+
+class Budget {
+public:
+    void apply(const IoLimits& limits) {
+        read_.setRate(limits.readBytesPerSec);
+        write_.setRate(limits.writeBytesPerSec);
+        meta_.setRate(limits.metaOpsPerSec);
+        enabled_ = limits.readBytesPerSec > 0 || limits.writeBytesPerSec > 0 || limits.metaOpsPerSec > 0
+            || !limitsFile_.empty();
+    }
+
+    void watchFile(const fs::path& file, fs::file_time_type mtime) {
+        std::lock_guard<std::mutex> lk(reloadMutex_);
+        limitsFile_ = file;
+        limitsMtime_ = mtime;
+        nextCheck_ = Clock::now() + std::chrono::seconds(1);
+    }
+
+    bool enabled() const { return enabled_; }
+
+    void charge(TokenBucket Budget::*bucket, double amount) {
+        if (!limitsFile_.empty()) reloadIfChanged();
+        (this->*bucket).acquire(amount);
+    }
+
+    TokenBucket read_, write_, meta_;
+
+private:
+    void reloadIfChanged() {
+        std::lock_guard<std::mutex> lk(reloadMutex_);
+        auto now = Clock::now();
+        if (now < nextCheck_) return;
+        nextCheck_ = now + std::chrono::seconds(1);
+        std::error_code ec;
+        auto mtime = fs::last_write_time(limitsFile_, ec);
+        if (ec || mtime == limitsMtime_) return;
+        limitsMtime_ = mtime;
+        std::ifstream in(limitsFile_);
+        std::stringstream text;
+        text << in.rdbuf();
+        IoLimits limits;
+        std::string error;
+        if (!in || !parseIoLimits(text.str(), limits, error)) {
+            std::cerr << "[IO limits] Ignoring " << limitsFile_ << ": " << (error.empty() ? "cannot read" : error)
+                      << " (previous limits kept)" << std::endl;
+            return;
+        }
+        apply(limits);
+        std::cerr << "[IO limits] " << describeIoLimits(limits) << std::endl;
+    }
+
+    std::atomic<bool> enabled_{ false };
+    std::mutex reloadMutex_;
+    fs::path limitsFile_;  // Set once before processing starts
+    fs::file_time_type limitsMtime_;
+    Clock::time_point nextCheck_;
+};
+
+Budget& budget() {
+    static Budget instance;
+    return instance;
+}
+
+bool parseAmount(const std::string& text, bool isSize, double& value) {
+    size_t pos = 0;
+    try {
+        value = std::stod(text, &pos);
+    } catch (const std::exception&) {
+        return false;
+    }
+    std::string suffix = text.substr(pos);
+    if (!suffix.empty() && (suffix.back() == 'B' || suffix.back() == 'b')) suffix.pop_back();
+    if (suffix.empty()) return value >= 0;
+    if (!isSize || suffix.size() != 1) return false;
+    switch (std::toupper(static_cast<unsigned char>(suffix[0]))) {
+    case 'K': value *= 1024.0; break;
+    case 'M': value *= 1024.0 * 1024.0; break;
+    case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+    default: return false;
+    }
+    return value >= 0;
+}
+
+std::string describeRate(double perSec, bool isSize) {
+    if (perSec <= 0) return "unlimited";
+    char buf[48];
+    if (isSize)
+        std::snprintf(buf, sizeof(buf), "%.1f MB/s", perSec / (1024.0 * 1024.0));
+    else
+        std::snprintf(buf, sizeof(buf), "%.0f ops/s", perSec);
+    return buf;
+}
+
+}  // namespace
+
+bool parseIoLimits(const std::string& spec, IoLimits& limits, std::string& error) {
+    limits = IoLimits();
+    std::string cleaned;
+    bool inComment = false;
+    for (char c : spec) {
+        if (c == '#') inComment = true;
+        if (c == '\n') inComment = false;
+        if (inComment) continue;
+        cleaned += (c == ',' || c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+    }
+    std::istringstream items(cleaned);
+    std::string item;
+    while (items >> item) {
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+        double* target = key == "read" ? &limits.readBytesPerSec
+            : key == "write" ? &limits.writeBytesPerSec
+            : key == "meta" ? &limits.metaOpsPerSec : nullptr;
+        if (!target) {
+            error = "unknown limit '" + key + "' (expected read=, write=, meta=)";
+            return false;
+        }
+        if (!parseAmount(value, target != &limits.metaOpsPerSec, *target)) {
+            error = "invalid value for " + key + ": '" + value + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string describeIoLimits(const IoLimits& limits) {
+    return "read " + describeRate(limits.readBytesPerSec, true) + ", write " + describeRate(limits.writeBytesPerSec, true)
+        + ", meta " + describeRate(limits.metaOpsPerSec, false);
+}
+
+bool configureIoLimits(const std::string& specOrFile, IoLimits& limits, std::string& error) {
+    std::string spec = specOrFile;
+    fs::path file;
+    if (!spec.empty() && spec[0] == '@') {
+        file = spec.substr(1);
+        std::ifstream in(file);
+        if (!in) {
+            error = "cannot read " + file.string();
+            return false;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        spec = text.str();
+    }
+    if (!parseIoLimits(spec, limits, error)) return false;
+    if (!file.empty()) {
+        std::error_code ec;
+        budget().watchFile(file, fs::last_write_time(file, ec));
+    }
+    budget().apply(limits);
+    return true;
+}
+
+void chargeReadBytes(uint64_t bytes) {
+    if (budget().enabled() && bytes > 0) budget().charge(&Budget::read_, static_cast<double>(bytes));
+}
+
+void chargeWriteBytes(uint64_t bytes) {
+    if (budget().enabled() && bytes > 0) budget().charge(&Budget::write_, static_cast<double>(bytes));
+}
+
+void chargeMetadataOps(unsigned count) {
+    if (budget().enabled() && count > 0) budget().charge(&Budget::meta_, static_cast<double>(count));
+}
+
+uint64_t fileSizeForBudget(const std::string& filePath) {
+    if (!budget().enabled()) return 0;  // Skip the stat when nothing is limited
+    std::error_code ec;
+    uint64_t size = fs::file_size(filePath, ec);
+    return ec ? 0 : size;
+}
+
+uint64_t headerReadBytes(const std::string& filePath) {
+    return std::min(fileSizeForBudget(filePath), kHeaderReadBytes);
+}
+
+}  // namespace filetimefixer
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace filetimefixer {
+
+// Process-wide I/O budget (--io-limits) so a run can share storage with live users.
+// Three token buckets: bytes read, bytes written and metadata operations (open, stat, rename,
+// utime) per second. A charge that exceeds the bucket is taken as debt and the caller sleeps
+// until it is paid back, so the long-run rate holds even for files larger than one second of budget.
+
+struct IoLimits {
+    double readBytesPerSec = 0;   // 0 = unlimited
+    double writeBytesPerSec = 0;
+    double metaOpsPerSec = 0;
+};
+
+/// Parse "read=50M,write=20M,meta=200" (separators: comma, space or newline; '#' starts a comment;
+/// sizes take K/M/G suffixes, powers of 1024). Keys that are not given stay unlimited.
+bool parseIoLimits(const std::string& spec, IoLimits& limits, std::string& error);
+
+/// Human-readable form of limits, e.g. "read 50.0 MB/s, write unlimited, meta 200 ops/s".
+std::string describeIoLimits(const IoLimits& limits);
+
+/// Set the budget from a spec, or from "@FILE": the file is re-read whenever it changes (checked
+/// at most once per second), so limits can be raised or lowered while a run is in progress.
+/// limits receives the initial values.
+bool configureIoLimits(const std::string& specOrFile, IoLimits& limits, std::string& error);
+
+/// Charge against the budget; block while over it. No-op (no lock) when no limit is configured.
+void chargeReadBytes(uint64_t bytes);
+void chargeWriteBytes(uint64_t bytes);
+void chargeMetadataOps(unsigned count = 1);
+
+/// Bytes a metadata (EXIF / container header) read of this file is charged: the header region,
+/// capped by the file size; 0 if the file cannot be stat'ed.
+uint64_t headerReadBytes(const std::string& filePath);
+/// Size of the file, 0 if it cannot be stat'ed (whole-file rewrites: Exiv2 writeMetadata, ffmpeg remux).
+uint64_t fileSizeForBudget(const std::string& filePath);
+
+}  // namespace filetimefixer
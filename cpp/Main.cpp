@@ -1,14 +1,37 @@
 #include "TimeParse.h"
+#include "FileNamePatterns.h"
 #include "TimeConvert.h"
 #include "ExifHelper.h"
 #include "FileTimeHelper.h"
 #include "ImageUtil.h"
 #include "TargetTimeResolver.h"
 #include "VideoMetaHelper.h"
+#include "FileProcessor.h"
+#include "MediaPipeline.h"
+#include "PlanFile.h"
+#include "FileIndex.h"
+#include "RunJournal.h"
+#include "IoBudget.h"
+#include "AdaptiveConcurrency.h"
+#include "DirectoryScanner.h"
+#include "DirectoryWatcher.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include <ctime>
 #ifdef _WIN32
@@ -26,24 +49,7 @@ static const char kDefaultTestFolder[] = "/tmp/time_fix_test";
 
 namespace {
 
-// On Windows convert ACP string to UTF-8 for log file; on other platforms return as-is.
-static std::string toUtf8ForLog(const std::string& s) {
-#ifdef _WIN32
-    if (s.empty()) return s;
-    int wlen = MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, nullptr, 0);
-    if (wlen <= 0) return s;
-    std::wstring wbuf(static_cast<size_t>(wlen), 0);
-    MultiByteToWideChar(CP_ACP, 0, s.c_str(), -1, &wbuf[0], wlen);
-    int ulen = WideCharToMultiByte(CP_UTF8, 0, wbuf.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    if (ulen <= 0) return s;
-    std::string out(static_cast<size_t>(ulen), 0);
-    WideCharToMultiByte(CP_UTF8, 0, wbuf.c_str(), -1, &out[0], ulen, nullptr, nullptr);
-    out.resize(static_cast<size_t>(ulen - 1));
-    return out;
-#else
-    return s;
-#endif
-}
+using filetimefixer::toUtf8ForLog;
 
 static std::string sanitizeForLogFilename(const std::string& s) {
     std::string out;
@@ -56,7 +62,8 @@ static std::string sanitizeForLogFilename(const std::string& s) {
     return out;
 }
 
-// Process a single image file (when path is a file rather than a directory).
+// Process a single image or video file (when path is a file rather than a directory): the same
+// processMediaFile steps as every file of a directory run, with a log and summary of its own.
 bool processSingleFile(const fs::path& filePath) {
     try {
         if (!fs::exists(filePath) || !fs::is_regular_file(filePath)) {
@@ -68,8 +75,6 @@ bool processSingleFile(const fs::path& filePath) {
             return false;
         }
         std::string pathStr = filePath.string();
-        std::string fileName = filePath.filename().string();
-        std::string fileExtension = filePath.extension().string();
         fs::path parentPath = filePath.parent_path();
 
         std::time_t now = std::time(nullptr);
@@ -92,100 +97,14 @@ bool processSingleFile(const fs::path& filePath) {
 
         std::cout << "---- Process single file: " << filePath << " ----" << std::endl;
 
-        bool renamedThisFile = false;
-        std::string finalPath = pathStr;
-        bool success = false;
-
-        try {
-            std::string nameTime = filetimefixer::parseFileNameTime(fileName);
-            std::string metaTimeRaw;
-            if (filetimefixer::isImageFile(filePath))
-                metaTimeRaw = filetimefixer::getExifTimeEarliest(pathStr);
-            else if (filetimefixer::isVideoFile(filePath))
-                metaTimeRaw = filetimefixer::getVideoCreationTimeUtc(pathStr);
-            std::string exifTime = filetimefixer::isImageFile(filePath)
-                ? filetimefixer::exifDateTimeToUTCString(metaTimeRaw)
-                : metaTimeRaw;
-
-            filetimefixer::ResolveResult resolved = filetimefixer::resolveTargetTime(nameTime, exifTime);
-            if (resolved.targetTime.empty()) {
-                std::cerr << "[Ignore] Unable to parse time: " << fileName << std::endl;
-                if (logFile) logFile << "  Error: Unable to parse time\n";
-                return false;
-            }
-            if (resolved.targetTime.length() <= 10)
-                resolved.targetTime = filetimefixer::supplementDateWithCurrentUtcTime(resolved.targetTime);
-
-            std::string formattedTimeStr = filetimefixer::formatTimeToUTC8Name(resolved.targetTime);
-            if (formattedTimeStr.empty()) {
-                std::cerr << "[Ignore] Failed to format time: " << resolved.targetTime << std::endl;
-                if (logFile) logFile << "  Error: Failed to format target time\n";
-                return false;
-            }
-
-            bool isImage = filetimefixer::isImageFile(filePath);
-            std::string targetFileName = (isImage ? "IMG_" : "VID_") + formattedTimeStr + fileExtension;
-            std::cout << fileName << " | NameTime: " << nameTime
-                      << ", ExifTime: " << exifTime << ", TargetTime: " << resolved.targetTime
-                      << " [" << filetimefixer::scenarioName(resolved.scenario) << "] => " << targetFileName << std::endl;
-
-            if (targetFileName != fileName) {
-                std::string newFilePath = parentPath.string() + "/" + targetFileName;
-                if (fs::exists(newFilePath)) {
-                    std::cerr << "Target file already exists: " << newFilePath << std::endl;
-                    if (logFile) logFile << "  Error: Target file already exists\n";
-                    return false;
-                }
-                if (!filetimefixer::renameFile(pathStr, newFilePath)) {
-                    std::cerr << "Rename failed: " << pathStr << std::endl;
-                    if (logFile) logFile << "  Error: Rename failed\n";
-                    return false;
-                }
-                finalPath = newFilePath;
-                renamedThisFile = true;
-            } else {
-                std::cout << "File name already correct: " << pathStr << std::endl;
-            }
-
-            bool exifOk = true;
-            std::string exifInfo;
-            if (isImage) {
-                exifOk = filetimefixer::modifyExifDataForTime(finalPath, resolved.targetTime);
-                exifInfo = filetimefixer::getExifTimeInfoString(finalPath);
-            } else {
-                exifOk = filetimefixer::setVideoCreationTime(finalPath, resolved.targetTime);
-                exifInfo = filetimefixer::getVideoTimeInfoString(finalPath);
-                if (exifInfo == "(no video metadata)") {
-                    std::string targetForDisplay = resolved.targetTime;
-                    if (targetForDisplay.size() >= 10 && targetForDisplay[10] == ' ')
-                        targetForDisplay[10] = 'T';
-                    exifInfo = "creation_time=" + targetForDisplay.substr(0, 19)
-                        + " (target written; read-back unavailable - ensure ffmpeg/ffprobe on PATH)";
-                }
-            }
-            bool fileTimeOk = filetimefixer::setFileTimesToTargetTime(fs::path(finalPath), resolved.targetTime);
-            if (isImage)
-                std::cout << "  [EXIF after fix] " << exifInfo << std::endl;
-            else
-                std::cout << "  [Video metadata after fix] " << exifInfo << std::endl;
-            if (!fileTimeOk) {
-                std::cerr << "File time modification failed: " << finalPath << std::endl;
-            } else {
-                success = true;
-            }
-            if (logFile) {
-                const char* metaLabel = isImage ? "EXIF after fix" : "Video metadata after fix";
-                logFile << "1. File: " << toUtf8ForLog(finalPath) << "\n  TargetTime: " << resolved.targetTime
-                        << "  EXIF_ok: " << (exifOk ? "yes" : "no")
-                        << "  FileTime_ok: " << (fileTimeOk ? "yes" : "no")
-                        << "\n  [" << metaLabel << "] " << toUtf8ForLog(exifInfo) << "\n";
-            }
-        } catch (const Exiv2::Error& e) {
-            std::cerr << "[Skip] Exiv2 error on " << fileName << ": " << e.what() << std::endl;
-            if (logFile) logFile << "  Error: Exiv2 - " << toUtf8ForLog(e.what()) << "\n";
-        } catch (const std::exception& e) {
-            std::cerr << "[Skip] Exception on " << fileName << ": " << e.what() << std::endl;
-            if (logFile) logFile << "  Error: " << toUtf8ForLog(e.what()) << "\n";
+        filetimefixer::TargetNameClaims claims;
+        filetimefixer::MediaTask task{ filePath, 1, 1 };
+        filetimefixer::MediaResult r = filetimefixer::processMediaFile(task, claims, std::cout, std::cerr);
+        const bool success = r.status == filetimefixer::MediaStatus::Success
+            || r.status == filetimefixer::MediaStatus::Unchanged;
+        if (logFile) {
+            logFile << r.logEntry;
+            if (!r.errorMessage.empty()) logFile << "  Error: " << toUtf8ForLog(r.errorMessage) << "\n";
         }
 
         std::cout << "------------------------------------------" << std::endl;
@@ -203,181 +122,687 @@ bool processSingleFile(const fs::path& filePath) {
     }
 }
 
-bool traverseDirectory(const fs::path& directory) {
-    try {
-        if (!fs::exists(directory) || !fs::is_directory(directory)) {
-            std::cerr << "Path does not exist or is not a directory: " << directory << std::endl;
-            return false;
-        }
+struct RunOptions {
+    unsigned jobs = 1;
+    bool jobsSet = false;  // --jobs given explicitly
+    bool staged = false;   // Use the scan -> read -> resolve -> write pipeline
+    filetimefixer::PipelineOptions pipeline;
+    std::string planPath;   // --plan: write a rename plan instead of changing files
+    std::string applyPath;  // --apply: run only the writes recorded in a plan
+    unsigned shardIndex = 0;  // --shard K/N: apply only records with logSeq % N == K
+    unsigned shardCount = 1;
+    std::string indexPath;  // --index: skip files normalized by earlier runs
+    unsigned scanJobs = 1;  // --scan-jobs: directories enumerated in parallel
+    bool watch = false;     // --watch: keep running and process files as they arrive
+    unsigned settleMs = 2000;  // --settle-ms: quiet time before a written file is processed
+    std::string journalPath;   // --journal: append-only record of renames and finished files
+    bool resume = false;       // --resume: skip files the journal lists as done, finish half-done renames
+    bool classJobs = false;    // --image-jobs / --video-jobs: separate pools per media class
+    unsigned imageJobs = 0;    // 0 = not given (defaults to --jobs, or one per core)
+    unsigned videoJobs = 1;
+    bool adaptive = false;          // --adaptive: AIMD on files in flight, up to --jobs (or 4 per core)
+    unsigned targetLatencyMs = 250; // --target-latency-ms: p90 stage latency to hold
+};
+
+// Log file, counters and error list of one run. record()/emit() may be called from worker threads.
+class RunReport {
+public:
+    bool open(const std::string& folderName, const std::string& title, const std::string& subject) {
         std::time_t now = std::time(nullptr);
         std::tm* lt = std::localtime(&now);
         char dateTimeBuf[32];
         std::snprintf(dateTimeBuf, sizeof(dateTimeBuf), "%04d%02d%02d_%02d%02d%02d",
             lt->tm_year + 1900, lt->tm_mon + 1, lt->tm_mday,
             lt->tm_hour, lt->tm_min, lt->tm_sec);
-        std::string folderName = directory.filename().string();
-        if (folderName.empty()) folderName = "folder";
         std::string logName = sanitizeForLogFilename(folderName) + "_" + dateTimeBuf + ".log";
-        fs::path logPath = fs::current_path() / logName;
-        std::ofstream logFile(logPath, std::ios::out | std::ios::app);
-        if (logFile) {
-            if (logFile.tellp() == 0)
-                logFile << "\xEF\xBB\xBF";  // UTF-8 BOM
-            logFile << "===== FileTimeFixer run " << dateTimeBuf << " =====\n";
-            logFile << "Directory: " << toUtf8ForLog(directory.string()) << "\n";
+        logPath_ = fs::current_path() / logName;
+        logFile_.open(logPath_, std::ios::out | std::ios::app);
+        if (logFile_) {
+            if (logFile_.tellp() == 0)
+                logFile_ << "\xEF\xBB\xBF";  // UTF-8 BOM
+            logFile_ << "===== FileTimeFixer " << title << " " << dateTimeBuf << " =====\n";
+            logFile_ << subject << "\n";
         }
+        return static_cast<bool>(logFile_);
+    }
+
+    // Print a line to console and log
+    void note(const std::string& line) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::cout << line << std::endl;
+        if (logFile_) logFile_ << line << "\n";
+    }
+
+    std::ofstream& log() { return logFile_; }
+    std::mutex& mutex() { return mutex_; }
+
+    // Caller holds mutex() when running in parallel
+    void record(const filetimefixer::MediaTask& task, const filetimefixer::MediaResult& r) {
+        using filetimefixer::MediaStatus;
+        if (r.status == MediaStatus::Success) successCount_++;
+        else if (r.status == MediaStatus::Unchanged) unchangedCount_++;
+        else if (r.status == MediaStatus::Planned) plannedCount_++;
+        writesAvoidedCount_ += r.writesAvoided;
+        if (!r.errorMessage.empty())
+            errorEntries_.emplace_back(task.logSeq, std::make_pair(r.errorPath, r.errorMessage));
+        if (logFile_ && !r.logEntry.empty()) logFile_ << r.logEntry;
+    }
+
+    // Print one file's buffered console output and record its result as one block
+    void emit(const filetimefixer::MediaTask& task, const filetimefixer::MediaResult& r,
+              const std::string& out, const std::string& err) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::cout << out << std::flush;
+        std::cerr << err << std::flush;
+        record(task, r);
+    }
+
+    // Error that belongs to no single file (e.g. a directory that cannot be read); listed first
+    void recordError(const std::string& path, const std::string& message) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        errorEntries_.emplace_back(0, std::make_pair(path, message));
+        directoryErrorCount_++;
+    }
+
+    // File skipped because the index says it is already normalized
+    void countSkipped() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        skippedCount_++;
+    }
+
+    // Time one file spent in its class pool (--image-jobs / --video-jobs)
+    void addClassTime(bool isVideo, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        ClassTime& t = isVideo ? videoTime_ : imageTime_;
+        if (t.files == 0 || start < t.firstStart) t.firstStart = start;
+        if (t.files == 0 || end > t.lastEnd) t.lastEnd = end;
+        t.busy += end - start;
+        t.files++;
+    }
+
+    // File skipped because the journal of an interrupted run says it is done (--resume)
+    void countJournaled() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        journaledCount_++;
+    }
+
+    void printSummary() {
+        // Errors are listed in traversal order regardless of completion order
+        std::stable_sort(errorEntries_.begin(), errorEntries_.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+        const int totalImageCount = successCount_ + unchangedCount_ + plannedCount_ + skippedCount_
+            + journaledCount_ + static_cast<int>(errorEntries_.size()) - directoryErrorCount_;
+        std::cout << "------------------------------------------" << std::endl;
+        std::cout << "[Summary]" << std::endl;
+        std::cout << "  Total processed: " << totalImageCount << std::endl;
+        if (plannedCount_ > 0)
+            std::cout << "  Planned:         " << plannedCount_ << std::endl;
+        std::cout << "  Success:         " << successCount_ << std::endl;
+        std::cout << "  Unchanged:       " << unchangedCount_ << std::endl;
+        if (skippedCount_ > 0)
+            std::cout << "  Skipped (index): " << skippedCount_ << std::endl;
+        if (journaledCount_ > 0)
+            std::cout << "  Skipped (journal): " << journaledCount_ << std::endl;
+        std::cout << "  Errors:          " << errorEntries_.size() << std::endl;
+        if (writesAvoidedCount_ > 0)
+            std::cout << "  Writes avoided:  " << writesAvoidedCount_ << std::endl;
+        if (logFile_) {
+            logFile_ << "------------------------------------------\n[Summary]\n"
+                     << "  Total: " << totalImageCount;
+            if (plannedCount_ > 0) logFile_ << "  Planned: " << plannedCount_;
+            logFile_ << "  Success: " << successCount_ << "  Unchanged: " << unchangedCount_;
+            if (skippedCount_ > 0) logFile_ << "  Skipped (index): " << skippedCount_;
+            if (journaledCount_ > 0) logFile_ << "  Skipped (journal): " << journaledCount_;
+            logFile_ << "  Errors: " << errorEntries_.size();
+            if (writesAvoidedCount_ > 0) logFile_ << "  Writes avoided: " << writesAvoidedCount_;
+            logFile_ << "\n";
+        }
+        printClassTime("Images", imageTime_);
+        printClassTime("Videos", videoTime_);
+        printLayoutHits();
+        if (!errorEntries_.empty()) {
+            std::cout << "[Error details]" << std::endl;
+            for (size_t i = 0; i < errorEntries_.size(); ++i) {
+                const auto& e = errorEntries_[i].second;
+                std::cout << "  " << (i + 1) << ". " << e.first << "\n      " << e.second << std::endl;
+                if (logFile_) logFile_ << "  Error: " << toUtf8ForLog(e.first) << " | " << toUtf8ForLog(e.second) << "\n";
+            }
+        }
+        std::cout << "------------------------------------------" << std::endl;
+        if (logFile_) {
+            logFile_ << "Log file: " << toUtf8ForLog(logPath_.string()) << "\n";
+            logFile_.close();
+            std::cout << "Log written to: " << logPath_.string() << std::endl;
+        }
+    }
+
+private:
+    struct ClassTime {
+        int files = 0;
+        std::chrono::steady_clock::duration busy{};  // Sum of per-file times (all workers)
+        std::chrono::steady_clock::time_point firstStart, lastEnd;
+    };
+
+    void printClassTime(const char* label, const ClassTime& t) {
+        if (t.files == 0) return;
+        using Seconds = std::chrono::duration<double>;
+        double busy = Seconds(t.busy).count();
+        double wall = Seconds(t.lastEnd - t.firstStart).count();
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %s: %d files, %.3f s busy, %.3f s wall, avg %.1f ms/file",
+                      label, t.files, busy, wall, busy * 1000.0 / t.files);
+        std::cout << line << std::endl;
+        if (logFile_) logFile_ << line << "\n";
+    }
+
+    // Which filename layouts matched this run (process-wide counters of findFileNameTime)
+    void printLayoutHits() {
+        const filetimefixer::FileNameLayoutStats stats = filetimefixer::fileNameLayoutStats();
+        std::ostringstream line;
+        for (size_t i = 0; i < filetimefixer::kFileNameLayoutCount; ++i) {
+            if (stats.hits[i] == 0) continue;
+            line << (line.tellp() > 0 ? ", " : "  Filename layouts: ")
+                 << filetimefixer::fileNameLayoutName(static_cast<filetimefixer::FileNameLayout>(i)) << " "
+                 << stats.hits[i];
+        }
+        if (line.tellp() <= 0) return;
+        if (stats.probeHits > 0) line << " (" << stats.probeHits << " by hot-layout probe)";
+        std::cout << line.str() << std::endl;
+        if (logFile_) logFile_ << line.str() << "\n";
+    }
+
+    fs::path logPath_;
+    std::ofstream logFile_;
+    std::mutex mutex_;
+    int successCount_ = 0;    // Processed with rename and/or EXIF/file-time change, no error
+    int unchangedCount_ = 0;  // No rename needed (filename already correct), no error
+    int plannedCount_ = 0;    // Written to a plan file (--plan), nothing changed
+    int skippedCount_ = 0;    // Already normalized according to --index, not opened
+    int journaledCount_ = 0;  // Finished by the interrupted run being resumed, not opened
+    int directoryErrorCount_ = 0;  // Errors from recordError, not files
+    int writesAvoidedCount_ = 0;  // Rename / metadata / file time steps already at the target
+    ClassTime imageTime_, videoTime_;
+    // (log sequence, (full path, error message))
+    std::vector<std::pair<int, std::pair<std::string, std::string>>> errorEntries_;
+};
+
+// Load --index (if given), for the --tz zone and --patterns of this run. Returns false on a corrupt index file.
+bool openIndex(const RunOptions& options, std::unique_ptr<filetimefixer::FileIndex>& index, RunReport& report) {
+    if (options.indexPath.empty()) return true;
+    index = std::make_unique<filetimefixer::FileIndex>();
+    filetimefixer::FileIndexSettings settings;
+    settings.timeZone = filetimefixer::localTimeZone().name();
+    if (const filetimefixer::FileNamePatternSet* patterns = filetimefixer::userFileNamePatterns())
+        settings.patternHash = patterns->fingerprint();
+    std::string error;
+    if (!index->load(options.indexPath, settings, error)) {
+        std::cerr << "Cannot load index " << options.indexPath << ": " << error << std::endl;
+        return false;
+    }
+    report.note("Index: " + options.indexPath + " (" + (error.empty() ? std::to_string(index->loadedCount()) + " entries"
+                                                         : error) + ")");
+    return true;
+}
+
+// After a write, remember the file's new identity so the next run can skip it after one stat.
+void recordInIndex(filetimefixer::FileIndex* index, const filetimefixer::MediaPlan& plan,
+                   const filetimefixer::MediaResult& r) {
+    if (!index || r.finalPath.empty()) return;
+    filetimefixer::FileKey key;
+    if (!filetimefixer::statFileKey(r.finalPath, key)) return;
+    filetimefixer::FileIndexEntry entry;
+    entry.targetTime = plan.resolved.targetTime;
+    entry.nameOk = fs::path(r.finalPath).filename().string() == plan.targetFileName;
+    entry.exifOk = r.exifOk;
+    entry.fileTimeOk = r.fileTimeOk;
+    index->record(key, entry);
+}
+
+void saveIndex(const RunOptions& options, filetimefixer::FileIndex* index, RunReport& report) {
+    if (!index) return;
+    if (index->save(options.indexPath))
+        report.note("Index saved: " + options.indexPath + " (" + std::to_string(index->currentCount()) + " entries)");
+    else
+        report.note("Index save failed: " + options.indexPath);
+}
+
+// Open --journal (if given). With --resume, first finish the renames an interrupted run left half
+// done: the file already has its new name, so only the EXIF / creation_time and file time steps
+// run again. Their paths go to `replayed` so the scan does not process them a second time.
+bool openJournal(const RunOptions& options, std::unique_ptr<filetimefixer::RunJournal>& journal,
+                 RunReport& report, filetimefixer::FileIndex* index, filetimefixer::TargetNameClaims& claims,
+                 int& logSeq, std::unordered_set<std::string>& replayed) {
+    if (options.journalPath.empty()) return true;
+    journal = std::make_unique<filetimefixer::RunJournal>();
+    std::string error;
+    if (!journal->open(options.journalPath, options.resume, error)) {
+        std::cerr << "Cannot open journal " << options.journalPath << ": " << error << std::endl;
+        return false;
+    }
+    const auto& unfinished = journal->unfinishedRenames();
+    report.note("Journal: " + options.journalPath + (options.resume
+        ? " (resume: " + std::to_string(journal->loadedDoneCount()) + " done, "
+            + std::to_string(unfinished.size()) + " unfinished renames)"
+        : " (new)"));
+    for (const auto& rename : unfinished) {
+        if (!fs::exists(rename.to)) continue;  // Rename did not stick; the scan picks up the source
+        filetimefixer::MediaPlan plan;
+        plan.task = filetimefixer::MediaTask{ rename.to, 0, ++logSeq };
+        plan.isImage = rename.isImage;
+        plan.resolved.targetTime = rename.targetTime;
+        plan.targetFileName = fs::path(rename.to).filename().string();
+        std::cout << "Resume: finishing " << rename.from << " -> " << rename.to << std::endl;
+        filetimefixer::MediaResult r = filetimefixer::applyMediaPlan(plan, claims, std::cout, std::cerr, journal.get());
+        recordInIndex(index, plan, r);
+        report.record(plan.task, r);
+        replayed.insert(rename.to);
+    }
+    return true;
+}
+
+void closeJournal(std::unique_ptr<filetimefixer::RunJournal>& journal, RunReport& report) {
+    if (journal && !journal->close())
+        report.note("Journal write error: the last files may be processed again on --resume");
+}
+
+// Serial (jobs <= 1) processes files inline in traversal order; jobs > 1 hands each media file
+// to a work-stealing pool; staged runs the per-stage pipeline with bounded queues.
+// With planPath set, only the read and resolve stages run and their result goes to the plan file.
+bool traverseDirectory(const fs::path& directory, const RunOptions& options) {
+    using filetimefixer::MediaPlan;
+    using filetimefixer::MediaResult;
+    using filetimefixer::MediaStatus;
+    using filetimefixer::MediaTask;
+    const unsigned jobs = options.jobs;
+    try {
+        if (!fs::exists(directory) || !fs::is_directory(directory)) {
+            std::cerr << "Path does not exist or is not a directory: " << directory << std::endl;
+            return false;
+        }
+        std::string folderName = directory.filename().string();
+        if (folderName.empty()) folderName = "folder";
+        RunReport report;
+        report.open(folderName, "run", "Directory: " + toUtf8ForLog(directory.string()));
 
         std::cout << "---- Traverse Directory: " << directory << " ----" << std::endl;
-        if (logFile) logFile << "---- Traverse Directory: " << toUtf8ForLog(directory.string()) << " ----\n";
+        if (report.log()) report.log() << "---- Traverse Directory: " << toUtf8ForLog(directory.string()) << " ----\n";
+        if (options.staged) {
+            const auto& p = options.pipeline;
+            std::ostringstream desc;
+            desc << "Pipeline: read " << p.readJobs << ", resolve " << p.resolveJobs
+                 << ", write " << p.writeJobs << ", queue depth " << p.queueDepth;
+            report.note(desc.str());
+        } else if (options.adaptive) {
+            report.note("Adaptive jobs: up to " + std::to_string(jobs) + ", target stage latency "
+                        + std::to_string(options.targetLatencyMs) + " ms");
+        } else if (options.classJobs) {
+            report.note("Image jobs: " + std::to_string(options.imageJobs)
+                        + ", video jobs: " + std::to_string(options.videoJobs));
+        } else if (jobs > 1) {
+            report.note("Parallel jobs: " + std::to_string(jobs));
+        }
+
+        std::unique_ptr<filetimefixer::PlanWriter> planWriter;
+        if (!options.planPath.empty()) {
+            planWriter = std::make_unique<filetimefixer::PlanWriter>();
+            if (!planWriter->open(options.planPath, directory.string())) {
+                std::cerr << "Cannot write plan file: " << options.planPath << std::endl;
+                return false;
+            }
+            report.note("Plan only (no file is changed): " + options.planPath);
+        }
+
+        std::unique_ptr<filetimefixer::FileIndex> index;
+        if (!openIndex(options, index, report)) return false;
 
         int totalFileCount = 0;
         int logSeq = 0;          // Sequence number for each file in log (1-based)
-        int successCount = 0;   // Processed with rename and/or EXIF/file-time change, no error
-        int unchangedCount = 0; // No rename needed (filename already correct), no error
-        std::vector<std::pair<std::string, std::string>> errorEntries; // (full path, error message)
+        filetimefixer::TargetNameClaims claims;
 
-        for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-            if (entry.is_directory()) {
-                std::cout << "---- Directory: " << entry.path() << " ----" << std::endl;
+        std::unique_ptr<filetimefixer::RunJournal> journal;
+        std::unordered_set<std::string> replayed;
+        if (!openJournal(options, journal, report, index.get(), claims, logSeq, replayed)) return false;
+
+        auto writeStage = [&](const MediaPlan& plan, std::ostream& out, std::ostream& err) {
+            if (!planWriter) {
+                MediaResult r = filetimefixer::applyMediaPlan(plan, claims, out, err, journal.get());
+                recordInIndex(index.get(), plan, r);
+                return r;
             }
-            if (!fs::is_regular_file(entry.status())) continue;
+            planWriter->append(plan);
+            MediaResult r;
+            r.status = MediaStatus::Planned;
+            return r;
+        };
+        // Stage errors are already results; anything thrown around them (index, journal, plan
+        // writer) still ends as an error on this file instead of dropping it
+        auto processTask = [&](const MediaTask& task, std::ostream& out, std::ostream& err) {
+            MediaResult r;
+            try {
+                filetimefixer::MediaRead read;
+                MediaPlan plan;
+                if (!filetimefixer::readMediaFile(task, read, r, err)) return r;
+                if (!filetimefixer::resolveMediaFile(read, plan, r, out, err)) return r;
+                return writeStage(plan, out, err);
+            } catch (const std::exception& e) {
+                err << "[Skip] Exception on " << task.path.filename().string() << ": " << e.what() << std::endl;
+                r.errorMessage = std::string("Exception: ") + e.what();
+            } catch (...) {
+                err << "[Skip] Unknown exception on " << task.path.filename().string() << std::endl;
+                r.errorMessage = "Unknown exception";
+            }
+            r.status = MediaStatus::Error;
+            r.errorPath = task.path.string();
+            return r;
+        };
+
+        // With --image-jobs / --video-jobs, videos (ffmpeg remux: seconds to minutes each) get a
+        // pool of their own so a few large files cannot hold up thousands of photos queued behind them.
+        std::unique_ptr<filetimefixer::WorkStealingPool> pool;
+        std::unique_ptr<filetimefixer::WorkStealingPool> videoPool;
+        std::unique_ptr<filetimefixer::MediaPipeline> pipeline;
+        std::unique_ptr<filetimefixer::AdaptiveConcurrency> adaptive;
+        if (options.staged) {
+            pipeline = std::make_unique<filetimefixer::MediaPipeline>(options.pipeline, writeStage,
+                [&](const MediaTask& task, const MediaResult& r, const std::string& out, const std::string& err) {
+                    report.emit(task, r, out, err);
+                });
+        } else if (options.classJobs) {
+            pool = std::make_unique<filetimefixer::WorkStealingPool>(options.imageJobs);
+            // Unbounded: a full video queue would block the scan, which also feeds the image pool.
+            // A waiting video is one path, so even a tree of videos only costs memory per file.
+            videoPool = std::make_unique<filetimefixer::WorkStealingPool>(options.videoJobs,
+                                                                          filetimefixer::WorkStealingPool::kUnbounded);
+        } else if (options.adaptive) {
+            // The pool has the ceiling number of threads; the controller decides how many may work
+            filetimefixer::AdaptiveOptions adaptiveOptions;
+            adaptiveOptions.maxJobs = jobs;
+            adaptiveOptions.targetLatency = std::chrono::milliseconds(options.targetLatencyMs);
+            adaptive = std::make_unique<filetimefixer::AdaptiveConcurrency>(adaptiveOptions,
+                [&](const std::string& line) { report.note(line); });
+            filetimefixer::setStageLatencyObserver(adaptive.get());
+            pool = std::make_unique<filetimefixer::WorkStealingPool>(jobs);
+        } else if (jobs > 1) {
+            pool = std::make_unique<filetimefixer::WorkStealingPool>(jobs);
+        }
 
+        filetimefixer::ScanCallbacks scan;
+        scan.onDirectory = [&](const fs::path& dir) {
+            std::lock_guard<std::mutex> lk(report.mutex());
+            std::cout << "---- Directory: " << dir << " ----" << std::endl;
+        };
+        scan.onFile = [&](const fs::path& path) {
             totalFileCount++;
-            if (!filetimefixer::isMediaFile(entry.path())) {
-                std::cout << "Non-media file: " << entry.path() << std::endl;
-                continue;
+            if (!filetimefixer::isMediaFile(path)) {
+                std::lock_guard<std::mutex> lk(report.mutex());
+                std::cout << "Non-media file: " << path << std::endl;
+                return;
             }
 
-            std::string filePath = entry.path().string();
-            std::string fileName = entry.path().filename().string();
-            std::string fileExtension = entry.path().extension().string();
-            bool renamedThisFile = false;
-            logSeq++;
-
-            try {
-                bool isImage = filetimefixer::isImageFile(entry.path());
-                std::string nameTime = filetimefixer::parseFileNameTime(fileName);
-                std::string metaTimeRaw;
-                if (isImage)
-                    metaTimeRaw = filetimefixer::getExifTimeEarliest(filePath);
-                else if (filetimefixer::isVideoFile(entry.path()))
-                    metaTimeRaw = filetimefixer::getVideoCreationTimeUtc(filePath);
-                std::string exifTime = isImage
-                    ? filetimefixer::exifDateTimeToUTCString(metaTimeRaw)
-                    : metaTimeRaw;
-
-                filetimefixer::ResolveResult resolved = filetimefixer::resolveTargetTime(nameTime, exifTime);
-                if (resolved.targetTime.empty()) {
-                    std::cerr << "[Ignore] Unable to parse time: " << fileName << std::endl;
-                    errorEntries.emplace_back(filePath, "Unable to parse time");
-                    continue;
-                }
-                if (resolved.targetTime.length() <= 10)
-                    resolved.targetTime = filetimefixer::supplementDateWithCurrentUtcTime(resolved.targetTime);
-
-                std::string formattedTimeStr = filetimefixer::formatTimeToUTC8Name(resolved.targetTime);
-                if (formattedTimeStr.empty()) {
-                    std::cerr << "[Ignore] Failed to format time: " << resolved.targetTime << std::endl;
-                    errorEntries.emplace_back(filePath, "Failed to format target time: " + resolved.targetTime);
-                    continue;
+            if (journal && (journal->isDone(path.string()) || replayed.count(path.string()))) {
+                report.countJournaled();
+                return;
+            }
+            if (index) {
+                filetimefixer::FileKey key;
+                if (filetimefixer::statFileKey(path, key) && index->isNormalized(key)) {
+                    report.countSkipped();
+                    return;
                 }
+            }
 
-                std::string targetFileName = (isImage ? "IMG_" : "VID_") + formattedTimeStr + fileExtension;
-                std::cout << totalFileCount << ": " << fileName << " | NameTime: " << nameTime
-                          << ", ExifTime: " << exifTime << ", TargetTime: " << resolved.targetTime
-                          << " [" << filetimefixer::scenarioName(resolved.scenario) << "] => " << targetFileName << std::endl;
-
-                std::string finalPath = filePath;
-                if (targetFileName != fileName) {
-                    std::string newFilePath = entry.path().parent_path().string() + "/" + targetFileName;
-                    if (fs::exists(newFilePath)) {
-                        std::cerr << "Target file already exists: " << newFilePath << std::endl;
-                        errorEntries.emplace_back(filePath, "Target file already exists: " + newFilePath);
-                        continue;
-                    }
-                    if (!filetimefixer::renameFile(filePath, newFilePath)) {
-                        std::cerr << "Rename failed: " << filePath << std::endl;
-                        errorEntries.emplace_back(filePath, "Rename failed");
-                        continue;
-                    }
-                    finalPath = newFilePath;
-                    renamedThisFile = true;
-                } else {
-                    std::cout << "File name already correct: " << filePath << std::endl;
-                }
+            MediaTask task{ path, totalFileCount, ++logSeq };
+            if (pipeline) {
+                pipeline->push(std::move(task));
+                return;
+            }
+            if (!pool) {
+                report.record(task, processTask(task, std::cout, std::cerr));
+                return;
+            }
+            if (videoPool) {
+                const bool isVideo = filetimefixer::isVideoFile(path);
+                (isVideo ? videoPool : pool)->submit([&, task, isVideo] {
+                    auto start = std::chrono::steady_clock::now();
+                    std::ostringstream out, err;
+                    MediaResult r = processTask(task, out, err);
+                    report.emit(task, r, out.str(), err.str());
+                    report.addClassTime(isVideo, start, std::chrono::steady_clock::now());
+                });
+                return;
+            }
+            pool->submit([&, task] {
+                if (adaptive) adaptive->acquire();
+                std::ostringstream out, err;
+                MediaResult r = processTask(task, out, err);
+                if (adaptive) adaptive->release();
+                report.emit(task, r, out.str(), err.str());
+            });
+        };
+        scan.onError = [&](const fs::path& dir, const std::string& message) {
+            report.recordError(dir.string(), message);
+        };
+        filetimefixer::ScanOptions scanOptions;
+        scanOptions.threads = options.scanJobs;
+        const bool scanned = filetimefixer::scanDirectoryTree(directory, scanOptions, scan, std::cerr);
+        if (pipeline) pipeline->finish();
+        if (pool) pool->wait();
+        if (videoPool) videoPool->wait();
+        const size_t failedTasks = (pool ? pool->failedTaskCount() : 0) + (videoPool ? videoPool->failedTaskCount() : 0);
+        if (failedTasks > 0)
+            report.note("Worker errors: " + std::to_string(failedTasks) + " files were not recorded (see stderr)");
+        if (adaptive) {
+            filetimefixer::setStageLatencyObserver(nullptr);
+            report.note("Adaptive jobs: " + adaptive->describe());
+        }
+        closeJournal(journal, report);
+        saveIndex(options, index.get(), report);
+        if (planWriter) {
+            bool ok = planWriter->close();
+            report.note("Plan written: " + options.planPath + " (" + std::to_string(planWriter->count()) + " files)"
+                        + (ok ? "" : " - WRITE ERROR, plan is incomplete"));
+        }
+        report.printSummary();
+        return scanned && failedTasks == 0;
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Filesystem error: " << e.what() << std::endl;
+        return false;
+    }
+}
 
-                bool exifOk = true;
-                std::string exifInfo;
-                if (isImage) {
-                    exifOk = filetimefixer::modifyExifDataForTime(finalPath, resolved.targetTime);
-                    exifInfo = filetimefixer::getExifTimeInfoString(finalPath);
-                } else {
-                    exifOk = filetimefixer::setVideoCreationTime(finalPath, resolved.targetTime);
-                    exifInfo = filetimefixer::getVideoTimeInfoString(finalPath);
-                    if (exifInfo == "(no video metadata)") {
-                        std::string targetForDisplay = resolved.targetTime;
-                        if (targetForDisplay.size() >= 10 && targetForDisplay[10] == ' ')
-                            targetForDisplay[10] = 'T';
-                        exifInfo = "creation_time=" + targetForDisplay.substr(0, 19)
-                            + " (target written; read-back unavailable - ensure ffmpeg/ffprobe on PATH)";
-                    }
-                }
-                bool fileTimeOk = filetimefixer::setFileTimesToTargetTime(fs::path(finalPath), resolved.targetTime);
-                if (isImage)
-                    std::cout << "  [EXIF after fix] " << exifInfo << std::endl;
-                else
-                    std::cout << "  [Video metadata after fix] " << exifInfo << std::endl;
-                if (!fileTimeOk) {
-                    std::cerr << "File time modification failed: " << finalPath << std::endl;
-                    errorEntries.emplace_back(finalPath, "File time modification failed");
-                } else {
-                    if (renamedThisFile) successCount++; else unchangedCount++;
+// --apply: run only the write stage for each record of a plan file, on options.jobs threads.
+// Records are streamed through a bounded queue so large plans do not have to fit in memory.
+bool applyPlanFile(const fs::path& planPath, const RunOptions& options) {
+    using filetimefixer::MediaPlan;
+    using filetimefixer::MediaResult;
+    using filetimefixer::MediaStatus;
+    filetimefixer::PlanReader reader;
+    std::string error;
+    if (!reader.open(planPath, error)) {
+        std::cerr << error << ": " << planPath << std::endl;
+        return false;
+    }
+    RunReport report;
+    report.open(planPath.stem().string(), "apply", "Plan: " + toUtf8ForLog(planPath.string())
+                + "\nDirectory: " + toUtf8ForLog(reader.rootDirectory()));
+    std::cout << "---- Apply plan: " << planPath << " ----" << std::endl;
+    const unsigned jobs = options.jobs == 0 ? 1 : options.jobs;
+    std::string desc = "Apply jobs: " + std::to_string(jobs);
+    if (options.shardCount > 1)
+        desc += ", shard " + std::to_string(options.shardIndex) + "/" + std::to_string(options.shardCount);
+    report.note(desc);
+    std::unique_ptr<filetimefixer::FileIndex> index;
+    if (!openIndex(options, index, report)) return false;
+
+    filetimefixer::TargetNameClaims claims;
+    std::unique_ptr<filetimefixer::RunJournal> journal;
+    std::unordered_set<std::string> replayed;
+    int logSeq = 0;
+    if (!openJournal(options, journal, report, index.get(), claims, logSeq, replayed)) return false;
+    filetimefixer::BoundedQueue<MediaPlan> queue(jobs * 64);
+    std::atomic<size_t> failedRecords{ 0 };
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobs; ++i) {
+        workers.emplace_back([&] {
+            MediaPlan plan;
+            while (queue.pop(plan)) {
+                // As processTask: anything thrown around the write stage (index, journal) is an
+                // error on this file, never an exception escaping the thread
+                std::ostringstream out, err;
+                MediaResult r;
+                try {
+                    r = filetimefixer::applyMediaPlan(plan, claims, out, err, journal.get());
+                    recordInIndex(index.get(), plan, r);
+                } catch (const std::exception& e) {
+                    err << "[Skip] Exception on " << plan.task.path.filename().string() << ": " << e.what() << std::endl;
+                    r.status = MediaStatus::Error;
+                    r.errorPath = plan.task.path.string();
+                    r.errorMessage = std::string("Exception: ") + e.what();
+                } catch (...) {
+                    err << "[Skip] Unknown exception on " << plan.task.path.filename().string() << std::endl;
+                    r.status = MediaStatus::Error;
+                    r.errorPath = plan.task.path.string();
+                    r.errorMessage = "Unknown exception";
                 }
-                if (logFile) {
-                    const char* metaLabel = isImage ? "EXIF after fix" : "Video metadata after fix";
-                    logFile << logSeq << ". File: " << toUtf8ForLog(finalPath) << "\n  TargetTime: " << resolved.targetTime
-                            << "  EXIF_ok: " << (exifOk ? "yes" : "no")
-                            << "  FileTime_ok: " << (fileTimeOk ? "yes" : "no")
-                            << "\n  [" << metaLabel << "] " << toUtf8ForLog(exifInfo) << "\n";
+                try {
+                    report.emit(plan.task, r, out.str(), err.str());
+                } catch (const std::exception& e) {  // Counted like a failed WorkStealingPool task
+                    std::cerr << "[Error] Worker task failed: " << e.what() << std::endl;
+                    ++failedRecords;
+                } catch (...) {
+                    std::cerr << "[Error] Worker task failed with an unknown exception" << std::endl;
+                    ++failedRecords;
                 }
-            } catch (const Exiv2::Error& e) {
-                std::cerr << "[Skip] Exiv2 error on " << fileName << ": " << e.what() << std::endl;
-                errorEntries.emplace_back(filePath, std::string("Exiv2 error: ") + e.what());
-            } catch (const std::exception& e) {
-                std::cerr << "[Skip] Exception on " << fileName << ": " << e.what() << std::endl;
-                errorEntries.emplace_back(filePath, std::string("Exception: ") + e.what());
+            }
+        });
+    }
+    MediaPlan plan;
+    while (reader.next(plan)) {
+        if (options.shardCount > 1 && static_cast<unsigned>(plan.task.logSeq) % options.shardCount != options.shardIndex)
+            continue;
+        if (journal) {
+            // The plan holds the original path; a finished or replayed file is known by either name
+            std::string planTarget = (plan.task.path.parent_path() / plan.targetFileName).string();
+            if (journal->isDone(plan.task.path.string()) || replayed.count(planTarget)) {
+                report.countJournaled();
+                continue;
             }
         }
+        queue.push(std::move(plan));
+    }
+    queue.close();
+    for (auto& t : workers) t.join();
+    closeJournal(journal, report);
+    bool ok = reader.error().empty() && failedRecords == 0;
+    if (!reader.error().empty()) report.note("Plan read error: " + reader.error() + " (remaining records skipped)");
+    if (failedRecords > 0)
+        report.note("Worker errors: " + std::to_string(failedRecords.load()) + " files were not recorded (see stderr)");
+    saveIndex(options, index.get(), report);
+    report.printSummary();
+    return ok;
+}
 
-        const int totalImageCount = successCount + unchangedCount + static_cast<int>(errorEntries.size());
-        std::cout << "------------------------------------------" << std::endl;
-        std::cout << "[Summary]" << std::endl;
-        std::cout << "  Total processed: " << totalImageCount << std::endl;
-        std::cout << "  Success:         " << successCount << std::endl;
-        std::cout << "  Unchanged:       " << unchangedCount << std::endl;
-        std::cout << "  Errors:          " << errorEntries.size() << std::endl;
-        if (logFile) {
-            logFile << "------------------------------------------\n[Summary]\n"
-                    << "  Total: " << totalImageCount << "  Success: " << successCount << "  Unchanged: " << unchangedCount << "  Errors: " << errorEntries.size() << "\n";
+std::atomic<bool> g_stopWatching{ false };
+
+void onStopSignal(int) {
+    g_stopWatching = true;
+}
+
+// --watch: process media files as they settle (closed after writing or moved into the tree),
+// one at a time, with the same read -> resolve -> apply steps as processMediaFile (and so a
+// single-file run), kept apart only to record the plan in the index. Runs until Ctrl+C /
+// SIGTERM, then prints the session summary.
+bool watchDirectory(const fs::path& directory, const RunOptions& options) {
+    using filetimefixer::MediaPlan;
+    using filetimefixer::MediaResult;
+    using filetimefixer::MediaTask;
+    try {
+        if (!fs::exists(directory) || !fs::is_directory(directory)) {
+            std::cerr << "Path does not exist or is not a directory: " << directory << std::endl;
+            return false;
         }
-        if (!errorEntries.empty()) {
-            std::cout << "[Error details]" << std::endl;
-            for (size_t i = 0; i < errorEntries.size(); ++i) {
-                std::cout << "  " << (i + 1) << ". " << errorEntries[i].first << "\n      " << errorEntries[i].second << std::endl;
-                if (logFile) logFile << "  Error: " << toUtf8ForLog(errorEntries[i].first) << " | " << toUtf8ForLog(errorEntries[i].second) << "\n";
+        std::string folderName = directory.filename().string();
+        if (folderName.empty()) folderName = "folder";
+        RunReport report;
+        report.open(folderName, "watch", "Directory: " + toUtf8ForLog(directory.string()));
+        std::cout << "---- Watch Directory: " << directory << " (Ctrl+C to stop) ----" << std::endl;
+
+        std::unique_ptr<filetimefixer::FileIndex> index;
+        if (!openIndex(options, index, report)) return false;
+
+        // Files this session wrote, with their identity right after the write: the rename and
+        // EXIF / creation_time write raise events of their own, which must not start another round.
+        // An entry is removed by that event, so only writes that raise one are recorded: a utime
+        // alone (IN_ATTRIB, not watched) or a file already at its target would stay forever.
+        std::map<fs::path, filetimefixer::FileKey> ownWrites;
+        int logSeq = 0;
+        auto onSettled = [&](const fs::path& path) {
+            if (filetimefixer::isVideoTempFile(path)) return;
+            filetimefixer::FileKey key;
+            if (!filetimefixer::statFileKey(path, key)) return;  // Gone again before it settled
+            auto own = ownWrites.find(path);
+            if (own != ownWrites.end()) {
+                bool unchangedSinceWrite = own->second == key;
+                ownWrites.erase(own);
+                if (unchangedSinceWrite) return;
             }
-        }
-        std::cout << "------------------------------------------" << std::endl;
-        if (logFile) {
-            logFile << "Log file: " << toUtf8ForLog(logPath.string()) << "\n";
-            logFile.close();
-            std::cout << "Log written to: " << logPath.string() << std::endl;
-        }
+            if (index && index->isNormalized(key)) {
+                report.countSkipped();
+                return;
+            }
+            ++logSeq;
+            MediaTask task{ path, logSeq, logSeq };
+            MediaResult r;
+            filetimefixer::MediaRead read;
+            MediaPlan plan;
+            // One file at a time, so the target-exists check alone guards name collisions
+            filetimefixer::TargetNameClaims claims;
+            if (filetimefixer::readMediaFile(task, read, r, std::cerr)
+                && filetimefixer::resolveMediaFile(read, plan, r, std::cout, std::cerr)) {
+                r = filetimefixer::applyMediaPlan(plan, claims, std::cout, std::cerr);
+                recordInIndex(index.get(), plan, r);
+                if ((r.renamed || r.metadataWritten) && !r.finalPath.empty()
+                    && filetimefixer::statFileKey(r.finalPath, key))
+                    ownWrites[r.finalPath] = key;
+            }
+            report.record(task, r);
+            if (report.log()) report.log().flush();
+        };
+
+        filetimefixer::WatchOptions watchOptions;
+        watchOptions.settle = std::chrono::milliseconds(options.settleMs);
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+        bool ok = filetimefixer::watchDirectoryTree(directory, watchOptions, onSettled, g_stopWatching, std::cerr);
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        if (index) index->retainLoaded();
+        saveIndex(options, index.get(), report);
+        report.printSummary();
+        return ok;
     } catch (const fs::filesystem_error& e) {
         std::cerr << "Filesystem error: " << e.what() << std::endl;
         return false;
     }
-    return true;
+}
+
+// Parse the number after a count option (argv[i]); 0 means one per CPU core.
+bool parseCountArg(int argc, char* argv[], int& i, unsigned& value) {
+    std::string name = argv[i];
+    if (i + 1 >= argc) {
+        std::cerr << name << " requires a number" << std::endl;
+        return false;
+    }
+    try {
+        int n = std::stoi(argv[++i]);
+        if (n < 0) throw std::invalid_argument("negative");
+        value = n == 0 ? filetimefixer::defaultJobCount() : static_cast<unsigned>(n);
+        return true;
+    } catch (const std::exception&) {
+        std::cerr << "Invalid value for " << name << ": " << argv[i] << std::endl;
+        return false;
+    }
 }
 
 void printHelp() {
@@ -392,6 +817,32 @@ void printHelp() {
         << "Options:\n"
         << "  --help, -h, /?                Show this help and exit\n"
         << "  --test, -t                    Run tests instead of processing files\n"
+        << "  --jobs N, -j N                Process N files in parallel (0 = one per CPU core; default 1)\n"
+        << "  --image-jobs N                Images get their own pool of N threads (default: --jobs, or one per core)\n"
+        << "  --video-jobs N                Videos get their own pool of N threads (default 1)\n"
+        << "  --adaptive                    Adjust files in flight (AIMD) to hold a stage latency, up to --jobs\n"
+        << "                                (default ceiling: 4 per core)\n"
+        << "  --target-latency-ms N         With --adaptive: p90 latency of open / rename / utime to hold (default 250)\n"
+        << "  --read-jobs N                 Staged pipeline: metadata read threads (default 1)\n"
+        << "  --resolve-jobs N              Staged pipeline: target time resolve threads (default 1)\n"
+        << "  --write-jobs N                Staged pipeline: rename / EXIF / file time threads (default 1)\n"
+        << "  --queue-depth N               Staged pipeline: capacity of each stage queue (default 256)\n"
+        << "  --plan FILE                   Read and resolve only; write the renames/times to a binary plan\n"
+        << "  --apply FILE                  Run only the writes from a plan (parallel; default one job per core)\n"
+        << "  --shard K/N                   With --apply: only records K, K+N, K+2N, ... (spread over hosts)\n"
+        << "  --scan-jobs N                 Enumerate N directories in parallel (Linux; default 1)\n"
+        << "  --index FILE                  Skip files normalized by earlier runs (keyed by device, inode, size, mtime)\n"
+        << "  --io-limits SPEC              Cap I/O, e.g. read=50M,write=20M,meta=200 (bytes/s, ops/s);\n"
+        << "                                @FILE reads SPEC from FILE and re-reads it when it changes\n"
+        << "  --patterns FILE               Extra filename layouts, one per line, e.g. dji = DJI_{Y4}{M2}{D2}{h2}{m2}{s2};\n"
+        << "                                tried before the built-in layouts\n"
+        << "  --adaptive-layouts            Try the built-in filename layouts that matched most often so far first\n"
+        << "  --tz ZONE                     Zone of filename / EXIF times: IANA name (Europe/Berlin), TZif path, UTC\n"
+        << "                                or +HH:MM (default UTC+8); EXIF OffsetTimeOriginal overrides per file\n"
+        << "  --journal FILE                Append renames and finished files to a crash-safe journal\n"
+        << "  --resume                      With --journal: skip finished files, complete half-done renames\n"
+        << "  --watch                       Keep running; process files once written and settled (Linux, inotify)\n"
+        << "  --settle-ms N                 With --watch: quiet time after the last write before processing (default 2000)\n"
         << "\n"
         << "Behavior:\n"
         << "  - Derives a target time from filename and EXIF / video metadata\n"
@@ -419,11 +870,9 @@ int main(int argc, char* argv[]) {
     std::cout << "Tip: Debug build may trigger 'abort()' on some images (Exiv2). For batch runs use Release: cmake --build . --config Release, then run Release\\FileTimeFixer.exe\n" << std::endl;
 #endif
     std::string dirToProcess;
-    if (argc < 2) {
-        dirToProcess = kDefaultTestFolder;
-        std::cout << "No path given, using default test folder:\n  " << dirToProcess << "\n" << std::endl;
-    } else {
-        std::string arg = argv[1];
+    RunOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
         if (arg == "--help" || arg == "-h" || arg == "/?") {
             printHelp();
             return 0;
@@ -432,11 +881,208 @@ int main(int argc, char* argv[]) {
             extern int runAllTests();
             return runAllTests();
         }
-        fs::path pathArg = fs::path(arg);
+        if (arg == "--jobs" || arg == "-j") {
+            if (!parseCountArg(argc, argv, i, options.jobs)) return 1;
+            options.jobsSet = true;
+            continue;
+        }
+        if (arg == "--index") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires an index file path" << std::endl;
+                return 1;
+            }
+            options.indexPath = argv[++i];
+            continue;
+        }
+        if (arg == "--plan" || arg == "--apply") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a plan file path" << std::endl;
+                return 1;
+            }
+            (arg == "--plan" ? options.planPath : options.applyPath) = argv[++i];
+            continue;
+        }
+        if (arg == "--shard") {
+            unsigned k = 0, n = 0;
+            char slash = 0;
+            std::istringstream ss(i + 1 < argc ? argv[i + 1] : "");
+            if (!(ss >> k >> slash >> n) || slash != '/' || n == 0 || k >= n) {
+                std::cerr << "--shard expects K/N with 0 <= K < N" << std::endl;
+                return 1;
+            }
+            ++i;
+            options.shardIndex = k;
+            options.shardCount = n;
+            continue;
+        }
+        if (arg == "--io-limits") {
+            filetimefixer::IoLimits limits;
+            std::string error;
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires read=RATE,write=RATE,meta=OPS or @FILE" << std::endl;
+                return 1;
+            }
+            std::string spec = argv[++i];
+            if (!filetimefixer::configureIoLimits(spec, limits, error)) {
+                std::cerr << "Invalid --io-limits: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "IO limits: " << filetimefixer::describeIoLimits(limits)
+                      << (spec[0] == '@' ? " (reloaded when " + spec.substr(1) + " changes)" : "") << std::endl;
+            continue;
+        }
+        if (arg == "--patterns") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a pattern file path" << std::endl;
+                return 1;
+            }
+            auto patterns = std::make_shared<filetimefixer::FileNamePatternSet>();
+            std::string error;
+            if (!patterns->loadFile(argv[++i], error) || !patterns->compile(error)) {
+                std::cerr << "Invalid --patterns: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Filename patterns: " << patterns->size() << " loaded, " << patterns->stateCount()
+                      << " DFA states" << std::endl;
+            filetimefixer::setUserFileNamePatterns(std::move(patterns));
+            continue;
+        }
+        if (arg == "--adaptive-layouts") {
+            filetimefixer::setAdaptiveFileNameLayouts(true);
+            continue;
+        }
+        if (arg == "--tz") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a time zone" << std::endl;
+                return 1;
+            }
+            auto zone = std::make_shared<filetimefixer::TimeZone>();
+            std::string error;
+            if (!filetimefixer::TimeZone::load(argv[++i], *zone, error)) {
+                std::cerr << "Invalid --tz: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Time zone: " << zone->name() << " (" << zone->transitionCount() << " transitions)"
+                      << std::endl;
+            filetimefixer::setLocalTimeZone(std::move(zone));
+            continue;
+        }
+        if (arg == "--journal") {
+            if (i + 1 >= argc) {
+                std::cerr << arg << " requires a journal file path" << std::endl;
+                return 1;
+            }
+            options.journalPath = argv[++i];
+            continue;
+        }
+        if (arg == "--resume") {
+            options.resume = true;
+            continue;
+        }
+        if (arg == "--watch") {
+            options.watch = true;
+            continue;
+        }
+        if (arg == "--settle-ms") {
+            // Unlike the job counts, 0 is a plain value here (process right after close)
+            try {
+                if (i + 1 >= argc) throw std::invalid_argument("missing");
+                int n = std::stoi(argv[++i]);
+                if (n < 0) throw std::invalid_argument("negative");
+                options.settleMs = static_cast<unsigned>(n);
+            } catch (const std::exception&) {
+                std::cerr << "--settle-ms requires a number of milliseconds" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--image-jobs" || arg == "--video-jobs") {
+            if (!parseCountArg(argc, argv, i, arg == "--image-jobs" ? options.imageJobs : options.videoJobs)) return 1;
+            options.classJobs = true;
+            continue;
+        }
+        if (arg == "--adaptive") {
+            options.adaptive = true;
+            continue;
+        }
+        if (arg == "--target-latency-ms") {
+            if (!parseCountArg(argc, argv, i, options.targetLatencyMs)) return 1;
+            continue;
+        }
+        if (arg == "--scan-jobs") {
+            if (!parseCountArg(argc, argv, i, options.scanJobs)) return 1;
+            continue;
+        }
+        unsigned* stageCount = nullptr;
+        if (arg == "--read-jobs") stageCount = &options.pipeline.readJobs;
+        else if (arg == "--resolve-jobs") stageCount = &options.pipeline.resolveJobs;
+        else if (arg == "--write-jobs") stageCount = &options.pipeline.writeJobs;
+        if (stageCount || arg == "--queue-depth") {
+            unsigned n = 0;
+            if (!parseCountArg(argc, argv, i, n)) return 1;
+            if (stageCount) *stageCount = n;
+            else options.pipeline.queueDepth = n;
+            options.staged = true;
+            continue;
+        }
+        if (!dirToProcess.empty()) {
+            std::cerr << "Unexpected argument: " << arg << std::endl;
+            return 1;
+        }
+        dirToProcess = arg;
+    }
+    if (options.classJobs) {
+        if (options.staged || !options.applyPath.empty() || options.watch) {
+            std::cerr << "--image-jobs / --video-jobs cannot be combined with the staged pipeline, --apply or --watch"
+                      << std::endl;
+            return 1;
+        }
+        if (options.imageJobs == 0)
+            options.imageJobs = options.jobsSet ? std::max(1u, options.jobs) : filetimefixer::defaultJobCount();
+    }
+    if (options.adaptive) {
+        if (options.staged || options.classJobs || !options.applyPath.empty() || options.watch) {
+            std::cerr << "--adaptive cannot be combined with the staged pipeline, --image-jobs / --video-jobs, "
+                      << "--apply or --watch" << std::endl;
+            return 1;
+        }
+        if (!options.jobsSet) options.jobs = std::min(64u, 4 * filetimefixer::defaultJobCount());
+    }
+    if (options.resume && options.journalPath.empty()) {
+        std::cerr << "--resume needs --journal FILE" << std::endl;
+        return 1;
+    }
+    if (!options.journalPath.empty() && (options.watch || !options.planPath.empty())) {
+        std::cerr << "--journal applies to directory runs and --apply, not to --watch or --plan" << std::endl;
+        return 1;
+    }
+    if (!options.applyPath.empty()) {
+        if (!dirToProcess.empty() || !options.planPath.empty()) {
+            std::cerr << "--apply takes no directory and cannot be combined with --plan" << std::endl;
+            return 1;
+        }
+        // The apply phase is pure writes: parallel by default
+        if (!options.jobsSet) options.jobs = filetimefixer::defaultJobCount();
+        if (options.jobs > 1) Exiv2::XmpParser::initialize();
+        return applyPlanFile(options.applyPath, options) ? 0 : 1;
+    }
+    if (options.watch) {
+        if (dirToProcess.empty() || !options.planPath.empty()) {
+            std::cerr << "--watch needs a directory and cannot be combined with --plan" << std::endl;
+            return 1;
+        }
+        return watchDirectory(dirToProcess, options) ? 0 : 1;
+    }
+    if (dirToProcess.empty()) {
+        dirToProcess = kDefaultTestFolder;
+        std::cout << "No path given, using default test folder:\n  " << dirToProcess << "\n" << std::endl;
+    } else {
+        fs::path pathArg = fs::path(dirToProcess);
         if (fs::exists(pathArg) && fs::is_regular_file(pathArg)) {
             return processSingleFile(pathArg) ? 0 : 1;
         }
-        dirToProcess = arg;
     }
-    return traverseDirectory(dirToProcess) ? 0 : 1;
+    // Exiv2's XMP parser must be initialized once before images are opened from several threads
+    if (options.jobs > 1 || options.staged || options.classJobs || options.adaptive) Exiv2::XmpParser::initialize();
+    return traverseDirectory(dirToProcess, options) ? 0 : 1;
 }
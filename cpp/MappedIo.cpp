@@ -0,0 +1,238 @@
+#include "MappedIo.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace filetimefixer {
+
+MappedIo::MappedIo(const std::string& path) : path_(path) {}
+
+MappedIo::~MappedIo() {
+    unmap();
+}
+
+void MappedIo::setPath(const std::string& path) {
+    close();
+    path_ = path;
+}
+
+// Map the whole file. The file handle is closed right away; the mapping keeps the file open.
+bool MappedIo::map(bool writable) {
+    unmap();
+#ifdef _WIN32
+    std::wstring wpath = std::filesystem::path(path_).wstring();
+    HANDLE file = CreateFileW(wpath.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    bool ok = GetFileSizeEx(file, &fileSize)
+        && static_cast<uint64_t>(fileSize.QuadPart) <= std::numeric_limits<size_t>::max();
+    if (ok && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingW(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+        void* view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (mapping) CloseHandle(mapping);  // The view holds on to the mapping
+        ok = view != nullptr;
+        data_ = static_cast<Exiv2::byte*>(view);
+    }
+    CloseHandle(file);
+    if (!ok) return false;
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path_.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && static_cast<uint64_t>(st.st_size) <= std::numeric_limits<size_t>::max();
+    if (ok && st.st_size > 0) {
+        void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED, fd, 0);
+        ok = view != MAP_FAILED;
+        if (ok) data_ = static_cast<Exiv2::byte*>(view);
+    }
+    ::close(fd);
+    if (!ok) return false;
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    writable_ = writable;
+    return true;
+}
+
+void MappedIo::unmap() {
+    if (data_) {
+#ifdef _WIN32
+        if (writable_) FlushViewOfFile(data_, 0);
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(data_, size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
+
+int MappedIo::open() {
+    close();
+    if (!map(false)) {
+        error_ = 1;
+        return 1;
+    }
+    open_ = true;
+    error_ = 0;
+    return 0;
+}
+
+int MappedIo::close() {
+    unmap();
+    open_ = false;
+    pos_ = 0;
+    eof_ = false;
+    return 0;
+}
+
+size_t MappedIo::write(const Exiv2::byte* data, size_t wcount) {
+    if (!open_ || (!writable_ && !mmap(true))) return 0;
+    size_t n = std::min<size_t>(wcount, size_ - pos_);
+    if (n > 0) std::memcpy(data_ + pos_, data, n);
+    pos_ += n;
+    return n;
+}
+
+size_t MappedIo::write(Exiv2::BasicIo& src) {
+    if (static_cast<Exiv2::BasicIo*>(this) == &src || !src.isopen()) return 0;
+    Exiv2::byte buf[4096];
+    size_t total = 0;
+    for (size_t n; (n = src.read(buf, sizeof(buf))) > 0;) {
+        size_t written = write(buf, n);
+        total += written;
+        if (written != n) break;
+    }
+    return total;
+}
+
+int MappedIo::putb(Exiv2::byte data) {
+    return write(&data, 1) == 1 ? data : EOF;
+}
+
+Exiv2::DataBuf MappedIo::read(size_t rcount) {
+    // Never allocate more than is left: a corrupt length field may ask for gigabytes
+    if (!open_) return Exiv2::DataBuf();
+    const size_t left = size_ - pos_;
+    if (rcount > left) {
+        eof_ = true;
+        rcount = left;
+    }
+    Exiv2::DataBuf buf(rcount);
+    buf.resize(read(buf.data(), rcount));
+    return buf;
+}
+
+size_t MappedIo::read(Exiv2::byte* buf, size_t rcount) {
+    if (!open_) return 0;
+    size_t n = std::min<size_t>(rcount, size_ - pos_);
+    if (n > 0) std::memcpy(buf, data_ + pos_, n);
+    pos_ += n;
+    if (n < rcount) eof_ = true;
+    return n;
+}
+
+int MappedIo::getb() {
+    if (!open_ || pos_ >= size_) {
+        eof_ = true;
+        return EOF;
+    }
+    return data_[pos_++];
+}
+
+// Exiv2 stores a rewritten image by transferring a MemIo holding it: write it over the file
+void MappedIo::transfer(Exiv2::BasicIo& src) {
+    const bool wasOpen = open_;
+    close();
+    bool ok = src.open() == 0;
+    if (ok) {
+        const size_t size = src.size();
+        const Exiv2::byte* data = size > 0 ? src.mmap() : nullptr;
+        ok = (size == 0 || data) && replaceContents(data, size);
+        src.munmap();
+        src.close();
+    }
+    if (!ok) {
+        error_ = 1;
+        throw Exiv2::Error(Exiv2::ErrorCode::kerTransferFailed, path_, "cannot write the file");
+    }
+    if (wasOpen) open();
+}
+
+bool MappedIo::replaceContents(const Exiv2::byte* data, size_t size) {
+    std::ofstream out(std::filesystem::path(path_), std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    if (size > 0) out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    out.close();
+    return !out.fail();
+}
+
+int MappedIo::seek(int64_t offset, Position pos) {
+    int64_t base = pos == beg ? 0 : pos == cur ? static_cast<int64_t>(pos_) : static_cast<int64_t>(size_);
+    int64_t target = base + offset;
+    if (!open_ || target < 0 || target > static_cast<int64_t>(size_)) return 1;
+    pos_ = static_cast<size_t>(target);
+    eof_ = false;
+    return 0;
+}
+
+// The mapping itself; with isWriteable the file is remapped so stores go to the file
+Exiv2::byte* MappedIo::mmap(bool isWriteable) {
+    if (!open_) return nullptr;
+    if (isWriteable && !writable_ && !map(true)) {
+        error_ = 1;
+        map(false);
+        return nullptr;
+    }
+    return data_;
+}
+
+// Back to a read-only mapping; stores made through mmap(true) are in the file
+int MappedIo::munmap() {
+    if (!open_ || !writable_) return 0;
+    return map(false) ? 0 : 1;
+}
+
+size_t MappedIo::tell() const {
+    return pos_;
+}
+
+size_t MappedIo::size() const {
+    if (open_) return size_;
+    std::error_code ec;
+    uintmax_t fileSize = std::filesystem::file_size(std::filesystem::path(path_), ec);
+    return ec ? std::numeric_limits<size_t>::max() : static_cast<size_t>(fileSize);
+}
+
+bool MappedIo::isopen() const {
+    return open_;
+}
+
+int MappedIo::error() const {
+    return error_;
+}
+
+bool MappedIo::eof() const {
+    return eof_;
+}
+
+const std::string& MappedIo::path() const noexcept {
+    return path_;
+}
+
+}  // namespace filetimefixer
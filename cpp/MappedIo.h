@@ -0,0 +1,62 @@
+#pragma once
+
+#include <exiv2/exiv2.hpp>
+#include <string>
+
+namespace filetimefixer {
+
+// Exiv2::BasicIo over a memory mapping of the file, on every platform. Exiv2 parses straight from
+// the page cache: reads copy only the bytes asked for and mmap() hands out the mapping itself, so
+// no file size is too large and nothing is read that Exiv2 does not look at. The path is opened
+// with the platform's wide/native API, never fopen, so names Exiv2's FileIo cannot open work too.
+//
+// Like FileIo, the file is mapped only while the io is open (Exiv2 closes it after each read or
+// write), so it can be renamed in between. Writes go to the file: transfer() (how Exiv2 stores a
+// rewritten image) replaces its contents, and mmap(true) maps it writable for Exiv2's in-place
+// TIFF updates. write() / putb() only overwrite bytes inside the file, they do not extend it.
+class MappedIo : public Exiv2::BasicIo {
+public:
+    explicit MappedIo(const std::string& path);
+    ~MappedIo() override;
+    MappedIo(const MappedIo&) = delete;
+    MappedIo& operator=(const MappedIo&) = delete;
+
+    /// Where the file is now, e.g. after a rename while the io was closed
+    void setPath(const std::string& path);
+
+    int open() override;
+    int close() override;
+    size_t write(const Exiv2::byte* data, size_t wcount) override;
+    size_t write(Exiv2::BasicIo& src) override;
+    int putb(Exiv2::byte data) override;
+    Exiv2::DataBuf read(size_t rcount) override;
+    size_t read(Exiv2::byte* buf, size_t rcount) override;
+    int getb() override;
+    void transfer(Exiv2::BasicIo& src) override;
+    int seek(int64_t offset, Position pos) override;
+    Exiv2::byte* mmap(bool isWriteable = false) override;
+    int munmap() override;
+    size_t tell() const override;
+    size_t size() const override;
+    bool isopen() const override;
+    int error() const override;
+    bool eof() const override;
+    const std::string& path() const noexcept override;
+    void populateFakeData() override {}
+
+private:
+    bool map(bool writable);
+    void unmap();
+    bool replaceContents(const Exiv2::byte* data, size_t size);
+
+    std::string path_;
+    Exiv2::byte* data_ = nullptr;  // The mapping (null for an empty file)
+    size_t size_ = 0;
+    size_t pos_ = 0;
+    bool open_ = false;
+    bool writable_ = false;
+    bool eof_ = false;
+    int error_ = 0;
+};
+
+}  // namespace filetimefixer
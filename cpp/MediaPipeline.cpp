@@ -0,0 +1,88 @@
+#include "MediaPipeline.h"
+#include <sstream>
+
+namespace filetimefixer {
+
+namespace {
+
+unsigned atLeastOne(unsigned n) { return n == 0 ? 1 : n; }
+
+}  // namespace
+
+MediaPipeline::MediaPipeline(const PipelineOptions& options, WriteStage writeStage, ResultSink sink)
+    : options_(options),
+      writeStage_(std::move(writeStage)),
+      sink_(std::move(sink)),
+      scanQueue_(options.queueDepth),
+      readQueue_(options.queueDepth),
+      planQueue_(options.queueDepth),
+      readersLeft_(atLeastOne(options.readJobs)),
+      resolversLeft_(atLeastOne(options.resolveJobs)) {
+    for (unsigned i = 0; i < atLeastOne(options_.readJobs); ++i)
+        threads_.emplace_back(&MediaPipeline::readLoop, this);
+    for (unsigned i = 0; i < atLeastOne(options_.resolveJobs); ++i)
+        threads_.emplace_back(&MediaPipeline::resolveLoop, this);
+    for (unsigned i = 0; i < atLeastOne(options_.writeJobs); ++i)
+        threads_.emplace_back(&MediaPipeline::writeLoop, this);
+}
+
+MediaPipeline::~MediaPipeline() {
+    finish();
+}
+
+void MediaPipeline::push(MediaTask task) {
+    scanQueue_.push(std::move(task));
+}
+
+void MediaPipeline::finish() {
+    if (finished_) return;
+    finished_ = true;
+    scanQueue_.close();
+    for (auto& t : threads_) t.join();
+}
+
+void MediaPipeline::readLoop() {
+    MediaTask task;
+    while (scanQueue_.pop(task)) {
+        std::ostringstream err;
+        Staged<MediaRead> staged;
+        MediaResult result;
+        if (!readMediaFile(task, staged.item, result, err)) {
+            sink_(task, result, "", err.str());
+            continue;
+        }
+        staged.err = err.str();
+        readQueue_.push(std::move(staged));
+    }
+    // Last reader out closes the next stage's input
+    if (--readersLeft_ == 0) readQueue_.close();
+}
+
+void MediaPipeline::resolveLoop() {
+    Staged<MediaRead> read;
+    while (readQueue_.pop(read)) {
+        std::ostringstream out, err;
+        Staged<MediaPlan> staged;
+        MediaResult result;
+        bool ok = resolveMediaFile(read.item, staged.item, result, out, err);
+        staged.out = read.out + out.str();
+        staged.err = read.err + err.str();
+        if (!ok) {
+            sink_(read.item.task, result, staged.out, staged.err);
+            continue;
+        }
+        planQueue_.push(std::move(staged));
+    }
+    if (--resolversLeft_ == 0) planQueue_.close();
+}
+
+void MediaPipeline::writeLoop() {
+    Staged<MediaPlan> plan;
+    while (planQueue_.pop(plan)) {
+        std::ostringstream out, err;
+        MediaResult result = writeStage_(plan.item, out, err);
+        sink_(plan.item.task, result, plan.out + out.str(), plan.err + err.str());
+    }
+}
+
+}  // namespace filetimefixer
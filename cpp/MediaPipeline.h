@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BoundedQueue.h"
+#include "FileProcessor.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace filetimefixer {
+
+struct PipelineOptions {
+    unsigned readJobs = 1;     // Metadata read threads (parse name, EXIF / ffprobe)
+    unsigned resolveJobs = 1;  // resolveTargetTime + target name threads
+    unsigned writeJobs = 1;    // Rename / EXIF write / file time threads
+    size_t queueDepth = 256;   // Capacity of each inter-stage queue
+};
+
+/// Staged scan -> read -> resolve -> write pipeline. The caller is the scan stage: it push()es
+/// tasks in traversal order and blocks when the read queue is full, so memory stays bounded
+/// no matter how many entries the tree has. Each stage has its own thread count.
+class MediaPipeline {
+public:
+    /// Called once per file from a pipeline thread (the caller synchronizes), with the console
+    /// output the stages produced for it.
+    using ResultSink = std::function<void(const MediaTask& task, const MediaResult& result,
+                                          const std::string& out, const std::string& err)>;
+    /// Last stage body: applyMediaPlan for a normal run, or recording the plan for --plan.
+    using WriteStage = std::function<MediaResult(const MediaPlan& plan, std::ostream& out, std::ostream& err)>;
+
+    MediaPipeline(const PipelineOptions& options, WriteStage writeStage, ResultSink sink);
+    ~MediaPipeline();
+
+    MediaPipeline(const MediaPipeline&) = delete;
+    MediaPipeline& operator=(const MediaPipeline&) = delete;
+
+    void push(MediaTask task);
+
+    /// Close the scan side and wait until every pushed file has been through all stages.
+    void finish();
+
+private:
+    template <typename Item>
+    struct Staged {
+        Item item;
+        std::string out;
+        std::string err;
+    };
+
+    void readLoop();
+    void resolveLoop();
+    void writeLoop();
+
+    PipelineOptions options_;
+    WriteStage writeStage_;
+    ResultSink sink_;
+    BoundedQueue<MediaTask> scanQueue_;
+    BoundedQueue<Staged<MediaRead>> readQueue_;
+    BoundedQueue<Staged<MediaPlan>> planQueue_;
+    std::atomic<unsigned> readersLeft_;
+    std::atomic<unsigned> resolversLeft_;
+    std::vector<std::thread> threads_;
+    bool finished_ = false;
+};
+
+}  // namespace filetimefixer
@@ -0,0 +1,173 @@
+#include "PlanFile.h"
+#include "FileIndex.h"
+
+namespace filetimefixer {
+
+namespace {
+
+const char kPlanMagic[8] = { 'F', 'T', 'F', 'P', 'L', 'A', 'N', '\0' };
+const uint32_t kPlanVersion = 3;
+const uint32_t kMaxStringLength = 64 * 1024;  // Guards against reading garbage lengths
+
+void putU32(std::string& buf, uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void putU64(std::string& buf, uint64_t v) {
+    putU32(buf, static_cast<uint32_t>(v));
+    putU32(buf, static_cast<uint32_t>(v >> 32));
+}
+
+void putStr(std::string& buf, const std::string& s) {
+    putU32(buf, static_cast<uint32_t>(s.size()));
+    buf += s;
+}
+
+void putTime(std::string& buf, const TimeValue& t) {
+    uint64_t ms = static_cast<uint64_t>(t.epochMs);
+    putU32(buf, static_cast<uint32_t>(ms));
+    putU32(buf, static_cast<uint32_t>(ms >> 32));
+    buf += static_cast<char>(t.precision);
+    putU32(buf, static_cast<uint32_t>(static_cast<int32_t>(t.offsetMinutes)));
+}
+
+bool getU32(std::istream& in, uint32_t& v) {
+    unsigned char b[4];
+    if (!in.read(reinterpret_cast<char*>(b), 4)) return false;
+    v = static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8)
+        | (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    return true;
+}
+
+bool getU64(std::istream& in, uint64_t& v) {
+    uint32_t low, high;
+    if (!getU32(in, low) || !getU32(in, high)) return false;
+    v = (static_cast<uint64_t>(high) << 32) | low;
+    return true;
+}
+
+bool getU8(std::istream& in, uint8_t& v) {
+    char c;
+    if (!in.get(c)) return false;
+    v = static_cast<uint8_t>(c);
+    return true;
+}
+
+bool getStr(std::istream& in, std::string& s) {
+    uint32_t len;
+    if (!getU32(in, len) || len > kMaxStringLength) return false;
+    s.resize(len);
+    return len == 0 || static_cast<bool>(in.read(&s[0], len));
+}
+
+bool getTime(std::istream& in, TimeValue& t) {
+    uint32_t low, high, offset;
+    uint8_t precision;
+    if (!getU32(in, low) || !getU32(in, high) || !getU8(in, precision) || !getU32(in, offset)
+        || precision > static_cast<uint8_t>(TimePrecision::Milliseconds))
+        return false;
+    t.epochMs = static_cast<int64_t>((static_cast<uint64_t>(high) << 32) | low);
+    t.precision = static_cast<TimePrecision>(precision);
+    t.offsetMinutes = static_cast<int16_t>(static_cast<int32_t>(offset));
+    return true;
+}
+
+}  // namespace
+
+bool PlanWriter::open(const fs::path& planPath, const std::string& rootDirectory) {
+    out_.open(planPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out_) return false;
+    std::string header(kPlanMagic, sizeof(kPlanMagic));
+    putU32(header, kPlanVersion);
+    putStr(header, rootDirectory);
+    out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    return static_cast<bool>(out_);
+}
+
+void PlanWriter::append(const MediaPlan& plan) {
+    std::string rec;
+    putU32(rec, static_cast<uint32_t>(plan.task.fileIndex));
+    putU32(rec, static_cast<uint32_t>(plan.task.logSeq));
+    rec += static_cast<char>(plan.isImage ? 1 : 0);
+    rec += static_cast<char>(plan.resolved.scenario);
+    putStr(rec, plan.task.path.string());
+    putTime(rec, plan.resolved.targetTime);
+    putStr(rec, plan.targetFileName);
+    // Identity of the source as planned, so --apply can tell it apart from another file at the target
+    FileKey source;
+    bool haveSource = statFileKey(plan.task.path, source);
+    rec += static_cast<char>(haveSource ? 1 : 0);
+    putU64(rec, haveSource ? source.device : 0);
+    putU64(rec, haveSource ? source.inode : 0);
+    putU64(rec, haveSource ? source.size : 0);
+    putU64(rec, haveSource ? static_cast<uint64_t>(source.mtimeNs) : 0);
+    std::lock_guard<std::mutex> lk(mutex_);
+    out_.write(rec.data(), static_cast<std::streamsize>(rec.size()));
+    ++count_;
+}
+
+bool PlanWriter::close() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    out_.flush();
+    bool ok = static_cast<bool>(out_);
+    out_.close();
+    return ok;
+}
+
+bool PlanReader::open(const fs::path& planPath, std::string& error) {
+    in_.open(planPath, std::ios::in | std::ios::binary);
+    if (!in_) {
+        error = "Cannot open plan file";
+        return false;
+    }
+    char magic[sizeof(kPlanMagic)];
+    uint32_t version = 0;
+    if (!in_.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != std::string(kPlanMagic, sizeof(kPlanMagic))) {
+        error = "Not a FileTimeFixer plan file";
+        return false;
+    }
+    if (!getU32(in_, version) || version != kPlanVersion) {
+        error = "Unsupported plan version " + std::to_string(version);
+        return false;
+    }
+    if (!getStr(in_, rootDirectory_)) {
+        error = "Truncated plan header";
+        return false;
+    }
+    return true;
+}
+
+bool PlanReader::next(MediaPlan& plan) {
+    uint32_t fileIndex;
+    if (!getU32(in_, fileIndex)) {
+        if (!in_.eof() || in_.gcount() != 0) error_ = "Truncated plan record";
+        return false;
+    }
+    uint32_t logSeq;
+    uint8_t isImage, scenario;
+    std::string path;
+    plan = MediaPlan{};
+    if (!getU32(in_, logSeq) || !getU8(in_, isImage) || !getU8(in_, scenario)
+        || !getStr(in_, path) || !getTime(in_, plan.resolved.targetTime) || !getStr(in_, plan.targetFileName)) {
+        error_ = "Truncated plan record";
+        return false;
+    }
+    uint8_t haveSource;
+    FileKey source;
+    uint64_t mtimeNs;
+    if (!getU8(in_, haveSource) || !getU64(in_, source.device) || !getU64(in_, source.inode) || !getU64(in_, source.size)
+        || !getU64(in_, mtimeNs)) {
+        error_ = "Truncated plan record";
+        return false;
+    }
+    source.mtimeNs = static_cast<int64_t>(mtimeNs);
+    if (haveSource) plan.plannedSource = source;
+    plan.task.path = path;
+    plan.task.fileIndex = static_cast<int>(fileIndex);
+    plan.task.logSeq = static_cast<int>(logSeq);
+    plan.isImage = isImage != 0;
+    plan.resolved.scenario = static_cast<TargetTimeScenario>(scenario);
+    return true;
+}
+
+}  // namespace filetimefixer
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "FileProcessor.h"
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace filetimefixer {
+
+// Binary rename plan (.ftfplan): everything applyMediaPlan needs, produced by --plan without
+// touching any file. Layout (little-endian):
+//   header: "FTFPLAN" '\0', u32 version, str rootDirectory
+//   record: u32 fileIndex, u32 logSeq, u8 isImage, u8 scenario, str path, time targetTime, str targetFileName,
+//           u8 hasSource, u64 sourceDevice, u64 sourceInode, u64 sourceSize, i64 sourceMtimeNs
+// where str = u32 byte length + bytes and time = i64 epochMs, u8 precision, i32 offsetMinutes.
+// Records run until end of file.
+
+/// Appends plan records; append() is safe to call from several threads.
+class PlanWriter {
+public:
+    bool open(const fs::path& planPath, const std::string& rootDirectory);
+    void append(const MediaPlan& plan);
+    /// Flush and close; returns false if any write failed.
+    bool close();
+    uint64_t count() const { return count_; }
+
+private:
+    std::mutex mutex_;
+    std::ofstream out_;
+    uint64_t count_ = 0;
+};
+
+/// Streams plan records back in file order.
+class PlanReader {
+public:
+    bool open(const fs::path& planPath, std::string& error);
+    /// Next record; false at end of file or on a truncated / corrupt record (see error()).
+    bool next(MediaPlan& plan);
+    const std::string& rootDirectory() const { return rootDirectory_; }
+    const std::string& error() const { return error_; }
+
+private:
+    std::ifstream in_;
+    std::string rootDirectory_;
+    std::string error_;
+};
+
+}  // namespace filetimefixer
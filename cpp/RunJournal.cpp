@@ -0,0 +1,261 @@
+#include "RunJournal.h"
+#include <chrono>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace filetimefixer {
+
+namespace {
+
+const char kJournalMagic[8] = { 'F', 'T', 'F', 'J', 'R', 'N', 'L', '\0' };
+const uint32_t kJournalVersion = 2;
+const uint32_t kMaxPayloadLength = 256 * 1024;
+const auto kCommitInterval = std::chrono::milliseconds(50);
+const size_t kCommitBytes = 256 * 1024;  // Commit early when this much is waiting
+
+void putU32(std::string& buf, uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void putStr(std::string& buf, const std::string& s) {
+    putU32(buf, static_cast<uint32_t>(s.size()));
+    buf += s;
+}
+
+void putTime(std::string& buf, const TimeValue& t) {
+    uint64_t ms = static_cast<uint64_t>(t.epochMs);
+    putU32(buf, static_cast<uint32_t>(ms));
+    putU32(buf, static_cast<uint32_t>(ms >> 32));
+    buf += static_cast<char>(t.precision);
+    putU32(buf, static_cast<uint32_t>(static_cast<int32_t>(t.offsetMinutes)));
+}
+
+uint32_t fnv1a(const std::string& s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Reads fields out of one payload; any read past the end marks the payload bad.
+class PayloadReader {
+public:
+    explicit PayloadReader(const std::string& s) : s_(s) {}
+    uint8_t u8() {
+        if (pos_ + 1 > s_.size()) { bad_ = true; return 0; }
+        return static_cast<uint8_t>(s_[pos_++]);
+    }
+    uint32_t u32() {
+        if (pos_ + 4 > s_.size()) { bad_ = true; return 0; }
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<unsigned char>(s_[pos_ + i])) << (8 * i);
+        pos_ += 4;
+        return v;
+    }
+    TimeValue time() {
+        TimeValue t;
+        uint64_t low = u32();
+        uint64_t high = u32();
+        uint8_t precision = u8();
+        int32_t offset = static_cast<int32_t>(u32());
+        if (precision > static_cast<uint8_t>(TimePrecision::Milliseconds)) bad_ = true;
+        if (bad_) return t;
+        t.epochMs = static_cast<int64_t>((high << 32) | low);
+        t.precision = static_cast<TimePrecision>(precision);
+        t.offsetMinutes = static_cast<int16_t>(offset);
+        return t;
+    }
+    std::string str() {
+        uint32_t len = u32();
+        if (bad_ || pos_ + len > s_.size()) { bad_ = true; return {}; }
+        std::string v = s_.substr(pos_, len);
+        pos_ += len;
+        return v;
+    }
+    bool ok() const { return !bad_ && pos_ == s_.size(); }
+
+private:
+    const std::string& s_;
+    size_t pos_ = 0;
+    bool bad_ = false;
+};
+
+bool readU32(std::istream& in, uint32_t& v) {
+    unsigned char b[4];
+    if (!in.read(reinterpret_cast<char*>(b), 4)) return false;
+    v = static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8)
+        | (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    return true;
+}
+
+bool syncFile(std::FILE* f) {
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return ::fsync(fileno(f)) == 0;
+#endif
+}
+
+}  // namespace
+
+RunJournal::~RunJournal() {
+    close();
+}
+
+bool RunJournal::load(const fs::path& journalPath, uint64_t& goodSize, std::string& error) {
+    goodSize = 0;
+    std::ifstream in(journalPath, std::ios::in | std::ios::binary);
+    if (!in) return true;  // Nothing journaled yet
+    char magic[8];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic))) return true;  // Empty or torn header: start over
+    if (std::string(magic, sizeof(magic)) != std::string(kJournalMagic, sizeof(kJournalMagic))
+        || !readU32(in, version)) {
+        error = "Not a FileTimeFixer journal";
+        return false;
+    }
+    if (version != kJournalVersion) {
+        error = "Unsupported journal version " + std::to_string(version);
+        return false;
+    }
+    goodSize = sizeof(kJournalMagic) + 4;
+
+    std::vector<JournalRename> renames;
+    std::string payload;
+    for (;;) {
+        uint32_t len = 0, sum = 0;
+        if (!readU32(in, len) || !readU32(in, sum) || len == 0 || len > kMaxPayloadLength) break;
+        payload.resize(len);
+        if (!in.read(&payload[0], len) || fnv1a(payload) != sum) break;
+        PayloadReader r(payload);
+        uint8_t type = r.u8();
+        if (type == 'R') {
+            JournalRename rename;
+            rename.from = r.str();
+            rename.to = r.str();
+            rename.isImage = r.u8() != 0;
+            rename.targetTime = r.time();
+            if (!r.ok()) break;
+            renames.push_back(std::move(rename));
+        } else if (type == 'D') {
+            std::string path = r.str();
+            std::string finalPath = r.str();
+            if (!r.ok()) break;
+            done_.insert(std::move(path));
+            done_.insert(std::move(finalPath));
+            ++loadedDone_;
+        } else {
+            break;
+        }
+        goodSize += 8 + len;
+    }
+    // A rename is unfinished if its new name never reached "done"; the last record per target wins
+    std::unordered_map<std::string, size_t> lastRename;
+    for (size_t i = 0; i < renames.size(); ++i) lastRename[renames[i].to] = i;
+    for (size_t i = 0; i < renames.size(); ++i) {
+        if (lastRename[renames[i].to] == i && !done_.count(renames[i].to))
+            unfinished_.push_back(std::move(renames[i]));
+    }
+    return true;
+}
+
+bool RunJournal::open(const fs::path& journalPath, bool resume, std::string& error) {
+    uint64_t goodSize = 0;
+    if (resume && !load(journalPath, goodSize, error)) return false;
+    if (goodSize > 0) {
+        std::error_code ec;
+        if (fs::file_size(journalPath, ec) != goodSize) fs::resize_file(journalPath, goodSize, ec);  // Cut a torn tail
+        if (ec) {
+            error = "Cannot truncate journal: " + ec.message();
+            return false;
+        }
+        file_ = std::fopen(journalPath.string().c_str(), "ab");
+    } else {
+        file_ = std::fopen(journalPath.string().c_str(), "wb");
+        if (file_) {
+            std::string header(kJournalMagic, sizeof(kJournalMagic));
+            putU32(header, kJournalVersion);
+            if (std::fwrite(header.data(), 1, header.size(), file_) != header.size() || std::fflush(file_) != 0
+                || !syncFile(file_))
+                writeFailed_ = true;
+        }
+    }
+    if (!file_) {
+        error = "Cannot open journal for writing";
+        return false;
+    }
+    committer_ = std::thread(&RunJournal::commitLoop, this);
+    return true;
+}
+
+bool RunJournal::close() {
+    if (!file_) return !writeFailed_;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_all();
+    if (committer_.joinable()) committer_.join();
+    if (std::fclose(file_) != 0) writeFailed_ = true;
+    file_ = nullptr;
+    return !writeFailed_;
+}
+
+void RunJournal::renamed(const MediaPlan& plan, const std::string& newPath) {
+    std::string payload(1, 'R');
+    putStr(payload, plan.task.path.string());
+    putStr(payload, newPath);
+    payload += static_cast<char>(plan.isImage ? 1 : 0);
+    putTime(payload, plan.resolved.targetTime);
+    append(payload);
+}
+
+void RunJournal::done(const std::string& path, const std::string& finalPath) {
+    std::string payload(1, 'D');
+    putStr(payload, path);
+    putStr(payload, finalPath);
+    append(payload);
+}
+
+void RunJournal::append(const std::string& payload) {
+    std::string rec;
+    putU32(rec, static_cast<uint32_t>(payload.size()));
+    putU32(rec, fnv1a(payload));
+    rec += payload;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        pending_ += rec;
+        wake = pending_.size() >= kCommitBytes;
+    }
+    if (wake) cv_.notify_one();
+}
+
+// Group commit: everything appended during one interval goes out with a single write + fsync.
+void RunJournal::commitLoop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        cv_.wait_for(lk, kCommitInterval, [this] { return closing_ || pending_.size() >= kCommitBytes; });
+        if (!pending_.empty()) {
+            std::string batch;
+            batch.swap(pending_);
+            lk.unlock();
+            bool ok = std::fwrite(batch.data(), 1, batch.size(), file_) == batch.size()
+                && std::fflush(file_) == 0 && syncFile(file_);
+            lk.lock();
+            if (!ok) writeFailed_ = true;
+            continue;  // Drain anything appended while writing before honoring closing_
+        }
+        if (closing_) return;
+    }
+}
+
+}  // namespace filetimefixer
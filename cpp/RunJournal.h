@@ -0,0 +1,72 @@
+#pragma once
+
+#include "FileProcessor.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace filetimefixer {
+
+// Append-only journal of a long run (--journal FILE), so a crashed or interrupted run can be
+// resumed (--resume) without redoing finished files. Layout (little-endian):
+//   header: "FTFJRNL" '\0', u32 version
+//   record: u32 payload length, u32 FNV-1a of payload, payload
+//   payload: u8 'R' (renamed), str from, str to, u8 isImage, time targetTime
+//          | u8 'D' (done),    str path, str finalPath
+// where str = u32 byte length + bytes and time = i64 epochMs, u8 precision, i32 offsetMinutes. A torn or corrupt tail (crash mid-write) ends the journal
+// and is cut off when it is reopened for append.
+
+// A rename that was journaled without a matching "done": metadata / file time may be missing.
+struct JournalRename {
+    std::string from;
+    std::string to;
+    bool isImage = false;
+    TimeValue targetTime;
+};
+
+/// Records are buffered and written by a background thread that fsyncs once per commit interval
+/// (group commit), so workers never wait for the disk. Losing the last interval on a crash only
+/// means those files are processed again. renamed()/done() are safe to call from several threads.
+class RunJournal {
+public:
+    ~RunJournal();
+
+    /// Start a new journal, or with resume load the existing one (missing file = empty) and
+    /// append to it. Returns false if the file cannot be opened or is not a journal.
+    bool open(const fs::path& journalPath, bool resume, std::string& error);
+    /// Flush, fsync and close; returns false if any write failed.
+    bool close();
+
+    /// Path (original or final) of a file finished by an earlier run of this journal.
+    bool isDone(const std::string& path) const { return done_.count(path) != 0; }
+    /// Renames from earlier runs whose metadata / file time step never finished, in journal order.
+    const std::vector<JournalRename>& unfinishedRenames() const { return unfinished_; }
+    size_t loadedDoneCount() const { return loadedDone_; }
+
+    void renamed(const MediaPlan& plan, const std::string& newPath);
+    void done(const std::string& path, const std::string& finalPath);
+
+private:
+    bool load(const fs::path& journalPath, uint64_t& goodSize, std::string& error);
+    void append(const std::string& payload);
+    void commitLoop();
+
+    std::FILE* file_ = nullptr;
+    std::unordered_set<std::string> done_;  // From disk; read-only once open() returns
+    std::vector<JournalRename> unfinished_;
+    size_t loadedDone_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string pending_;  // Encoded records waiting for the next commit
+    bool closing_ = false;
+    bool writeFailed_ = false;
+    std::thread committer_;
+};
+
+}  // namespace filetimefixer
@@ -1,14 +1,8 @@
 #include "TargetTimeResolver.h"
 #include "TimeConvert.h"
-#include <algorithm>
 
 namespace filetimefixer {
 
-static std::string normalizeForCompare(std::string s) {
-    if (s.size() > 10 && s[10] == ' ') s[10] = 'T';
-    return s;
-}
-
 const char* scenarioName(TargetTimeScenario s) {
     switch (s) {
         case TargetTimeScenario::NoTime: return "None";
@@ -25,86 +19,59 @@ const char* scenarioName(TargetTimeScenario s) {
     }
 }
 
-static bool hasDate(const std::string& s) {
-    return s.length() >= 10 && s.find('-') != std::string::npos;
+static bool sameDay(const FileNameTime& a, const FileNameTime& b) {
+    return a.year == b.year && a.month == b.month && a.day == b.day;
 }
 
-// True if string has time-of-day (e.g. "YYYY-MM-DDTHH:MM:SS" or "YYYY-MM-DD HH:MM:SS")
-static bool hasTimeOfDay(const std::string& s) {
-    return s.length() >= 19 && (s[10] == 'T' || s[10] == ' ');
+static bool sameMinute(const FileNameTime& a, const FileNameTime& b) {
+    return sameDay(a, b) && a.hour == b.hour && a.minute == b.minute;
 }
 
-// True if string is date-only (no precise time to minute)
-static bool isDateOnly(const std::string& s) {
-    if (s.length() <= 10) return true;
-    if (s.length() >= 19 && s[10] == 'T' && s.substr(11, 8) == "00:00:00") return true;
-    return false;
+static bool isMidnight(const FileNameTime& t) {
+    return t.hour == 0 && t.minute == 0 && t.second == 0;
 }
 
-ResolveResult resolveTargetTime(const std::string& nameTime, const std::string& exifTime) {
+ResolveResult resolveTargetTime(const TimeValue& nameTime, const TimeValue& exifTime, const TimeZone& zone) {
     ResolveResult out;
-    if (nameTime.empty() && exifTime.empty()) {
-        out.scenario = TargetTimeScenario::NoTime;
+    auto use = [&out](const TimeValue& value, TimeSource source, TargetTimeScenario scenario) {
+        out.targetTime = value;
+        out.source = source;
+        out.scenario = scenario;
         return out;
+    };
+    if (nameTime.empty() && exifTime.empty()) return out;
+    if (exifTime.empty()) return use(nameTime, TimeSource::Name, TargetTimeScenario::NameOnly);
+    if (nameTime.empty()) return use(exifTime, TimeSource::Exif, TargetTimeScenario::ExifOnly);
+
+    FileNameTime name = wallTime(nameTime, zone);
+    FileNameTime exif = wallTime(exifTime, zone);
+    // Use name time when EXIF date is before 2010-01-01
+    if (exif.year < 2010) return use(nameTime, TimeSource::Name, TargetTimeScenario::ExifTooOldUseName);
+
+    // Same day: prefer the more precise time (use Exif when name is date-only, use name when exif is
+    // date-only; EXIF at exactly midnight counts as date-only)
+    bool sameDate = sameDay(name, exif);
+    if (sameDate) {
+        bool exifDateOnly = !exifTime.hasTimeOfDay() || isMidnight(exif);
+        if (!nameTime.hasTimeOfDay() && exifTime.hasTimeOfDay())
+            return use(exifTime, TimeSource::Exif, TargetTimeScenario::SameDayNameDateOnlyUseExif);
+        if (exifDateOnly && nameTime.hasTimeOfDay())
+            return use(nameTime, TimeSource::Name, TargetTimeScenario::SameDayExifDateOnlyUseName);
     }
-    if (!nameTime.empty() && exifTime.empty()) {
-        out.targetTime = nameTime;
-        out.scenario = TargetTimeScenario::NameOnly;
-        return out;
-    }
-    if (nameTime.empty() && !exifTime.empty()) {
-        out.targetTime = exifTime;
-        out.scenario = TargetTimeScenario::ExifOnly;
-        return out;
-    }
-    // Both non-empty
-    if (!hasDate(nameTime) || !hasDate(exifTime)) {
-        out.targetTime = hasDate(nameTime) ? nameTime : exifTime;
-        out.scenario = hasDate(nameTime) ? TargetTimeScenario::NameOnly : TargetTimeScenario::ExifOnly;
-        return out;
-    }
-    // Use name time when EXIF date is before 2010-01-01 (date part only)
-    if (exifTime.substr(0, 10) < "2010-01-01") {
-        out.targetTime = nameTime;
-        out.scenario = TargetTimeScenario::ExifTooOldUseName;
-        return out;
-    }
-    // Same day: prefer the more precise time (use Exif when name is date-only, use name when exif is date-only)
-    if (nameTime.length() >= 10 && exifTime.length() >= 10 && nameTime.substr(0, 10) == exifTime.substr(0, 10)) {
-        if (isDateOnly(nameTime) && hasTimeOfDay(exifTime)) {
-            out.targetTime = exifTime;
-            out.scenario = TargetTimeScenario::SameDayNameDateOnlyUseExif;
-            return out;
-        }
-        if (isDateOnly(exifTime) && hasTimeOfDay(nameTime)) {
-            out.targetTime = nameTime;
-            out.scenario = TargetTimeScenario::SameDayExifDateOnlyUseName;
-            return out;
-        }
-    }
-    std::string nName = normalizeForCompare(nameTime);
-    std::string nExif = normalizeForCompare(exifTime);
-    out.targetTime = (nName <= nExif) ? nameTime : exifTime;
-    out.scenario = TargetTimeScenario::BothUseEarliest;
+    if (nameTime.epochMs <= exifTime.epochMs)
+        use(nameTime, TimeSource::Name, TargetTimeScenario::BothUseEarliest);
+    else
+        use(exifTime, TimeSource::Exif, TargetTimeScenario::BothUseEarliest);
 
-    if (nameTime.length() >= 10 && exifTime.length() >= 10 && nameTime.substr(0, 10) == exifTime.substr(0, 10)) {
-        bool exifMidnight = exifTime.length() >= 19 && exifTime.substr(11, 8) == "00:00:00";
-        bool nameMidnight = nameTime.length() >= 19 && nameTime.substr(11, 8) == "00:00:00";
-        if (exifMidnight) {
-            out.targetTime = nameTime;
-            out.scenario = TargetTimeScenario::SameDayExifMidnightUseName;
-            return out;
-        }
-        if (nameMidnight) {
-            out.targetTime = exifTime;
-            out.scenario = TargetTimeScenario::SameDayNameMidnightUseExif;
-            return out;
-        }
-        std::string nNameToMin = nName.substr(0, 16);
-        std::string nExifToMin = nExif.substr(0, 16);
-        if (nNameToMin == nExifToMin) {
-            out.targetTime = (nName > nExif) ? nameTime : exifTime;
-            out.scenario = TargetTimeScenario::SameDayBothFullUseMorePrecise;
+    if (sameDate) {
+        if (exifTime.hasTimeOfDay() && isMidnight(exif))
+            return use(nameTime, TimeSource::Name, TargetTimeScenario::SameDayExifMidnightUseName);
+        if (nameTime.hasTimeOfDay() && isMidnight(name))
+            return use(exifTime, TimeSource::Exif, TargetTimeScenario::SameDayNameMidnightUseExif);
+        if (nameTime.hasTimeOfDay() && exifTime.hasTimeOfDay() && sameMinute(name, exif)) {
+            if (nameTime.epochMs > exifTime.epochMs)
+                return use(nameTime, TimeSource::Name, TargetTimeScenario::SameDayBothFullUseMorePrecise);
+            return use(exifTime, TimeSource::Exif, TargetTimeScenario::SameDayBothFullUseMorePrecise);
         }
     }
     return out;
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <string>
+#include "TimeValue.h"
+#include "TimeZone.h"
 
 namespace filetimefixer {
 
@@ -18,13 +19,19 @@ enum class TargetTimeScenario {
     SameDayExifDateOnlyUseName    // exif has date only, name has time -> use name
 };
 
+// Which input the target time was taken from
+enum class TimeSource { NoSource, Name, Exif };
+
 struct ResolveResult {
-    std::string targetTime;
+    TimeValue targetTime;
     TargetTimeScenario scenario = TargetTimeScenario::NoTime;
+    TimeSource source = TimeSource::NoSource;
 };
 
-// Resolve target time and scenario from nameTime and exifTime (both in normalized format)
-ResolveResult resolveTargetTime(const std::string& nameTime, const std::string& exifTime);
+// Resolve target time and scenario from nameTime and exifTime (EXIF or video metadata). Calendar
+// days, midnight and minutes are compared on the wall clock of zone (the file's local zone).
+ResolveResult resolveTargetTime(const TimeValue& nameTime, const TimeValue& exifTime,
+                                const TimeZone& zone = localTimeZone());
 
 const char* scenarioName(TargetTimeScenario s);
 
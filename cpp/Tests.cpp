@@ -2,9 +2,29 @@
 #include "TimeConvert.h"
 #include "TargetTimeResolver.h"
 #include "ExifHelper.h"
+#include "ExifTimeReader.h"
+#include "MappedIo.h"
+#include "FileNamePatterns.h"
+#include "CivilTime.h"
+#include "TimeZone.h"
+#include "WorkerPool.h"
+#include "RunJournal.h"
+#include "PlanFile.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -30,6 +50,8 @@ void runFileNameTests() {
         { "VID_20210801_171003.jpg", "2021-08-01 17:10:03" },
         { "PANO_20231001_143241.jpg", "2023-10-01 14:32:41" },
         { "MTXX_PT20230623_190638417.jpg", "2023-06-23 19:06:38" },
+        { "pt2021_10_23_21_52_39.jpg", "2021-10-23 21:52:39" },
+        { "Screenshot_2021-03-25-01-12-43-235_com.tencent.mm.jpg", "2021-03-25 01:12:43" },
         { "mmexport1568301595980.jpg", "2019-09-12 23:19:55.980" },
         { "mmexport1602999370599.jpg", "2020-10-18 13:36:10.599" },
         { "MEITU_20240807_123043882.jpg", "2024-08-07 12:30:43" },
@@ -69,18 +91,25 @@ void runResolverTests() {
         { "2023-10-23 00:00:00", "2023-10-23T14:30:00", "2023-10-23T14:30:00", filetimefixer::TargetTimeScenario::SameDayNameMidnightUseExif },
         { "2023-10-23 14:30:00", "2023-10-23T14:30:00", "2023-10-23T14:30:00", filetimefixer::TargetTimeScenario::SameDayBothFullUseMorePrecise },
         { "2023-10-23 14:30:01", "2023-10-23T14:30:00", "2023-10-23 14:30:01", filetimefixer::TargetTimeScenario::SameDayBothFullUseMorePrecise },
+        { "2024-11-12", "2024-11-12T15:18:32", "2024-11-12T15:18:32", filetimefixer::TargetTimeScenario::SameDayNameDateOnlyUseExif },
+        { "2024-11-12 10:00:00", "2024-11-12", "2024-11-12 10:00:00", filetimefixer::TargetTimeScenario::SameDayExifDateOnlyUseName },
     };
 
     int passed = 0, failed = 0;
     for (const auto& c : cases) {
-        filetimefixer::ResolveResult r = filetimefixer::resolveTargetTime(c.nameTime, c.exifTime);
-        bool okTime = (r.targetTime == c.expectedTargetTime);
+        // Both sides are wall clock in UTC+8; the target is one of the inputs, reported by source
+        filetimefixer::ResolveResult r = filetimefixer::resolveTargetTime(
+            filetimefixer::parseTimeValue(c.nameTime, filetimefixer::kBeijingOffsetMinutes),
+            filetimefixer::parseTimeValue(c.exifTime, filetimefixer::kBeijingOffsetMinutes));
+        std::string target = r.source == filetimefixer::TimeSource::Name ? c.nameTime
+            : r.source == filetimefixer::TimeSource::Exif ? c.exifTime : "";
+        bool okTime = (target == c.expectedTargetTime);
         bool okScenario = (r.scenario == c.expectedScenario);
         bool ok = okTime && okScenario;
         if (ok) ++passed; else ++failed;
         std::cout << (ok ? "[PASS]" : "[FAIL]") << " name=\"" << (c.nameTime.empty() ? "(empty)" : c.nameTime)
                   << "\" exif=\"" << (c.exifTime.empty() ? "(empty)" : c.exifTime) << "\"\n"
-                  << "       => " << (r.targetTime.empty() ? "(empty)" : r.targetTime)
+                  << "       => " << (target.empty() ? "(empty)" : target)
                   << " [" << filetimefixer::scenarioName(r.scenario) << "]";
         if (!ok) {
             std::cout << "\n       expected => " << (c.expectedTargetTime.empty() ? "(empty)" : c.expectedTargetTime)
@@ -91,6 +120,108 @@ void runResolverTests() {
     std::cout << "\nResolver tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
 }
 
+// TimeValue conversions: name / EXIF read as UTC+8, video creation_time as UTC, independent of the host zone
+void runTimeValueTests() {
+    using filetimefixer::TimeValue;
+    std::cout << "\n========== Typed time values (TimeValue) ==========\n" << std::endl;
+    const int beijing = filetimefixer::kBeijingOffsetMinutes;
+    const filetimefixer::TimeZone& local = filetimefixer::localTimeZone();
+    TimeValue name = filetimefixer::parseTimeValue("2023-10-23 12:00:00", beijing);
+    TimeValue exif = filetimefixer::exifDateTimeToTimeValue("2023:10:23 12:00:05");
+    TimeValue video = filetimefixer::parseTimeValue("2023-10-23T04:00:03", 0);
+    TimeValue millis = filetimefixer::parseTimeValue("2019-09-12 23:19:55.980", beijing);
+    TimeValue date = filetimefixer::parseTimeValue("2022-01-15", beijing);
+    struct Case { std::string what; std::string got; std::string expected; };
+    std::vector<Case> cases = {
+        { "name epoch", std::to_string(name.epochMs), "1698033600000" },
+        { "video display", filetimefixer::formatTimeValue(video), "2023-10-23 04:00:03+00:00" },
+        { "video name stem", filetimefixer::formatTimeToLocalName(filetimefixer::inTimeZone(video, local)),
+          "20231023_120003" },
+        { "ms name stem", filetimefixer::formatTimeToLocalName(millis), "20190912_231955_980" },
+        { "date display", filetimefixer::formatTimeValue(date), "2022-01-15" },
+        { "exif value", filetimefixer::formatTimeForExif(exif), "2023:10:23 12:00:05" },
+        { "video exif value", filetimefixer::formatTimeForExif(video), "2023:10:23 04:00:03" },
+        { "video exif local", filetimefixer::formatTimeForExif(filetimefixer::inTimeZone(video, local)),
+          "2023:10:23 12:00:03" },
+        { "invalid date", std::to_string(filetimefixer::parseTimeValue("2023-02-30 10:00:00", beijing).empty()), "1" },
+        { "ffprobe suffix", filetimefixer::formatTimeValue(filetimefixer::parseTimeValue("2023-10-23T04:00:03Z", 0)),
+          "2023-10-23 04:00:03+00:00" },
+        { "colon date only", filetimefixer::formatTimeValue(filetimefixer::parseTimeValue("2024:02:29", beijing)),
+          "2024-02-29" },
+        { "bad separator", std::to_string(filetimefixer::parseTimeValue("2023-10:23 10:00:00", beijing).empty()), "1" },
+        { "bad time digit", std::to_string(filetimefixer::parseTimeValue("2023-10-23 1a:00:00", beijing).empty()), "1" },
+        { "hour 24", std::to_string(filetimefixer::parseTimeValue("2023-10-23 24:00:00", beijing).empty()), "1" },
+        { "bad millis", std::to_string(filetimefixer::parseTimeValue("2023-10-23 10:00:00.9x9", beijing).empty()), "1" },
+        { "utc timestamp", std::to_string(filetimefixer::utcStringToTimestamp("2023:10:23 04:00:03")), "1698033603" },
+        { "iso utc", filetimefixer::timestampToUTCString(1698033603), "2023-10-23T04:00:03" },
+        { "iso before 1970", filetimefixer::timestampToUTCString(-1), "1969-12-31T23:59:59" },
+        { "date name stem", filetimefixer::formatTimeToLocalName(date), "20220115_000000" },
+        { "west offset", filetimefixer::formatTimeValue(filetimefixer::parseTimeValue("2023-10-23 04:00:03", -570)),
+          "2023-10-23 04:00:03-09:30" },
+        { "name vs video", filetimefixer::scenarioName(filetimefixer::resolveTargetTime(name, video).scenario),
+          "SameDayBothFullUseMorePrecise" },
+        { "name vs video target", filetimefixer::formatTimeValue(filetimefixer::resolveTargetTime(name, video).targetTime),
+          "2023-10-23 04:00:03+00:00" },
+    };
+    int passed = 0, failed = 0;
+    for (const auto& c : cases) {
+        bool ok = c.got == c.expected;
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(22) << std::left << c.what << " => " << c.got;
+        if (!ok) std::cout << "  (expected: " << c.expected << ")";
+        std::cout << std::endl;
+    }
+    std::cout << "\nTimeValue tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// --tz and EXIF OffsetTimeOriginal: offsets from a transition table, DST gaps and overlaps
+void runTimeZoneTests() {
+    using filetimefixer::TimeZone;
+    std::cout << "\n========== Time zones (TimeZone) ==========\n" << std::endl;
+    struct Case { std::string what; std::string got; std::string expected; };
+    auto offset = [](const std::string& text) {
+        int minutes = 0;
+        return filetimefixer::parseUtcOffset(text, minutes) ? std::to_string(minutes) : std::string("invalid");
+    };
+    auto wall = [](const std::string& text, const TimeZone& zone) {
+        return filetimefixer::formatTimeValue(filetimefixer::parseTimeValue(text, zone));
+    };
+    TimeZone plus2 = TimeZone::fixed(120);
+    std::vector<Case> cases = {
+        { "offset +08:00", offset("+08:00"), "480" },
+        { "offset -0930", offset("-0930"), "-570" },
+        { "offset +05", offset("+05"), "300" },
+        { "offset 08:00", offset("08:00"), "invalid" },
+        { "offset +8:00", offset("+8:00"), "invalid" },
+        { "default zone", filetimefixer::localTimeZone().name(), "UTC+08:00" },
+        { "EXIF override", wall("2023-06-01 12:00:00", plus2), "2023-06-01 12:00:00+02:00" },
+        { "override stem", filetimefixer::formatTimeToLocalName(filetimefixer::inTimeZone(
+              filetimefixer::parseTimeValue("2023-06-01 10:00:00", 0), plus2)), "20230601_120000" },
+    };
+    TimeZone newYork;
+    std::string error;
+    if (TimeZone::load("America/New_York", newYork, error)) {
+        auto at = [&newYork](int64_t utc) { return std::to_string(newYork.offsetSecondsAt(utc) / 3600); };
+        cases.push_back({ "NY before DST", at(1678604399), "-5" });  // 2023-03-12 06:59:59Z
+        cases.push_back({ "NY in DST", at(1678604400), "-4" });
+        cases.push_back({ "NY 2090 DST", at(3802550400), "-4" });  // 2090-07-01, from the POSIX rule
+        cases.push_back({ "NY summer", wall("2023-07-01 12:00:00", newYork), "2023-07-01 12:00:00-04:00" });
+        cases.push_back({ "NY gap", wall("2023-03-12 02:30:00", newYork), "2023-03-12 03:30:00-04:00" });
+        cases.push_back({ "NY overlap", wall("2023-11-05 01:30:00", newYork), "2023-11-05 01:30:00-04:00" });
+    } else {
+        std::cout << "[SKIP] America/New_York (" << error << ")" << std::endl;
+    }
+    int passed = 0, failed = 0;
+    for (const auto& c : cases) {
+        bool ok = c.got == c.expected;
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(16) << std::left << c.what << " => " << c.got;
+        if (!ok) std::cout << "  (expected: " << c.expected << ")";
+        std::cout << std::endl;
+    }
+    std::cout << "\nTimeZone tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
 // EXIF output format is "YYYY:MM:DD HH:MM:SS" (colons in date, T -> space)
 void runExifFormatTests() {
     std::cout << "\n========== EXIF time format (formatTimeForExif) ==========\n" << std::endl;
@@ -115,6 +246,779 @@ void runExifFormatTests() {
     std::cout << "\nEXIF format tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
 }
 
+// Native EXIF time reader on JPEG / TIFF bytes built here: both byte orders, inline and offset
+// values, and the layouts it must hand to Exiv2
+std::vector<uint8_t> makeExifTiff(bool littleEndian, bool withExifIfd) {
+    std::vector<uint8_t> b;
+    auto put16 = [&](uint16_t v) {
+        uint8_t lo = v & 0xFF, hi = v >> 8;
+        b.insert(b.end(), littleEndian ? std::initializer_list<uint8_t>{ lo, hi } : std::initializer_list<uint8_t>{ hi, lo });
+    };
+    auto put32 = [&](uint32_t v) {
+        put16(static_cast<uint16_t>(littleEndian ? v & 0xFFFF : v >> 16));
+        put16(static_cast<uint16_t>(littleEndian ? v >> 16 : v & 0xFFFF));
+    };
+    auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+        put16(tag);
+        put16(type);
+        put32(count);
+        put32(value);
+    };
+    // Header, IFD0 (DateTime, Exif pointer) at 8, Exif IFD at 38, strings from 80
+    b.insert(b.end(), { uint8_t(littleEndian ? 'I' : 'M'), uint8_t(littleEndian ? 'I' : 'M') });
+    put16(42);
+    put32(8);
+    put16(withExifIfd ? 2 : 1);
+    entry(0x0132, 2, 20, 80);
+    if (withExifIfd) entry(0x8769, 4, 1, 38);
+    put32(0);
+    if (!withExifIfd) b.resize(38, 0);
+    put16(3);
+    entry(0x9003, 2, 20, 100);
+    entry(0x9004, 2, 20, 120);
+    entry(0x9011, 2, 7, 140);
+    put32(0);
+    for (const char* text : { "2023:10:23 12:00:05", "2023:10:23 11:59:58", "2023:10:23 11:59:59" })
+        b.insert(b.end(), text, text + 20);
+    b.insert(b.end(), "+02:00", "+02:00" + 7);
+    return b;
+}
+
+std::vector<uint8_t> makeExifJpeg(const std::vector<uint8_t>& tiff) {
+    std::vector<uint8_t> b = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0 };
+    b.resize(2 + 2 + 0x10, 0);  // APP0 body
+    uint16_t length = static_cast<uint16_t>(2 + 6 + tiff.size());
+    b.insert(b.end(), { 0xFF, 0xE1, uint8_t(length >> 8), uint8_t(length & 0xFF), 'E', 'x', 'i', 'f', 0, 0 });
+    b.insert(b.end(), tiff.begin(), tiff.end());
+    b.insert(b.end(), { 0xFF, 0xDA, 0x00, 0x02, 0xFF, 0xD9 });
+    return b;
+}
+
+void runExifReaderTests() {
+    std::cout << "\n========== Native EXIF time reader (ExifTimeReader) ==========\n" << std::endl;
+    using filetimefixer::ExifReadStatus;
+    auto read = [](const std::vector<uint8_t>& bytes, filetimefixer::ExifTimeTags& tags) {
+        return filetimefixer::readExifTimeTags(
+            [&bytes](uint64_t offset, uint8_t* dst, size_t n) {
+                if (offset + n > bytes.size()) return false;
+                std::memcpy(dst, bytes.data() + offset, n);
+                return true;
+            },
+            bytes.size(), tags);
+    };
+    // Tags as "original|digitized|datetime|offset", each value checked against the bytes at its offset
+    auto describe = [](const std::vector<uint8_t>& bytes, ExifReadStatus status, const filetimefixer::ExifTimeTags& tags) {
+        if (status != ExifReadStatus::Ok) return std::string(status == ExifReadStatus::NoExif ? "no exif" : "unsupported");
+        std::string out;
+        for (const auto* tag : { &tags.dateTimeOriginal, &tags.dateTimeDigitized, &tags.dateTime, &tags.offsetTimeOriginal }) {
+            bool atOffset = tag->fileOffset + tag->value.size() <= bytes.size()
+                && std::string(bytes.begin() + tag->fileOffset, bytes.begin() + tag->fileOffset + tag->value.size()) == tag->value;
+            out += (out.empty() ? "" : "|") + (tag->present ? (atOffset ? tag->value : "@bad offset") : "-");
+        }
+        return out + " earliest " + filetimefixer::earliestExifTime(tags);
+    };
+    const std::string all = "2023:10:23 11:59:58|2023:10:23 11:59:59|2023:10:23 12:00:05|+02:00 earliest 2023:10:23 11:59:58";
+    std::vector<uint8_t> truncated = makeExifJpeg(makeExifTiff(true, true));
+    truncated.resize(60);
+    std::vector<uint8_t> badPointer = makeExifTiff(true, true);
+    badPointer[8 + 2 + 12 + 8] = 0xF0;  // Exif IFD offset far past the end
+    std::vector<uint8_t> longType = makeExifTiff(false, true);
+    longType[8 + 2 + 3] = 3;  // DateTime as SHORT
+    struct Case { std::string what; std::vector<uint8_t> bytes; std::string expected; };
+    std::vector<Case> cases = {
+        { "TIFF little-endian", makeExifTiff(true, true), all },
+        { "TIFF big-endian", makeExifTiff(false, true), all },
+        { "JPEG APP0 + APP1", makeExifJpeg(makeExifTiff(false, true)), all },
+        { "IFD0 only", makeExifTiff(true, false), "-|-|2023:10:23 12:00:05|- earliest 2023:10:23 12:00:05" },
+        { "JPEG without EXIF", { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x04, 0, 0, 0xFF, 0xDA, 0x00, 0x02 }, "no exif" },
+        { "PNG", { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n', 0, 0, 0, 0 }, "unsupported" },
+        { "truncated APP1", truncated, "unsupported" },
+        { "Exif IFD out of range", badPointer, "unsupported" },
+        { "DateTime not ASCII", longType, "unsupported" },
+    };
+    int passed = 0, failed = 0;
+    for (const auto& c : cases) {
+        filetimefixer::ExifTimeTags tags;
+        std::string got = describe(c.bytes, read(c.bytes, tags), tags);
+        bool ok = got == c.expected;
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(24) << std::left << c.what << " => " << got;
+        if (!ok) std::cout << "  (expected: " << c.expected << ")";
+        std::cout << std::endl;
+    }
+
+    // In-place write: only the three 19-byte values change, the file keeps its size, and the session
+    // reports what was read back
+    const std::vector<uint8_t> original = makeExifJpeg(makeExifTiff(true, true));
+    const std::filesystem::path tmp = std::filesystem::temp_directory_path() / "ftf_exif_inplace_test.jpg";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(original.data()), static_cast<std::streamsize>(original.size()));
+    }
+    filetimefixer::ExifSession session;
+    const filetimefixer::TimeValue target = filetimefixer::parseTimeValue("2024-02-29 23:59:58", filetimefixer::kBeijingOffsetMinutes);
+    bool alreadySet = false;
+    bool written = session.writeTime(tmp.string(), target, alreadySet) && !alreadySet;
+    auto readBack = [&tmp] {
+        std::ifstream in(tmp, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    const std::vector<uint8_t> after = readBack();
+    size_t changed = 0;
+    for (size_t i = 0; i < std::min(original.size(), after.size()); ++i) changed += original[i] != after[i];
+    filetimefixer::ExifTimeTags tags;
+    std::string got = describe(after, read(after, tags), tags);
+    const std::string expected = "2024:02:29 23:59:58|2024:02:29 23:59:58|2024:02:29 23:59:58|+02:00 earliest 2024:02:29 23:59:58";
+    bool ok = written && after.size() == original.size() && changed <= 3 * filetimefixer::kExifTimeLength
+        && got == expected && session.timeInfoString().find("Exif.Image.DateTime=2024:02:29 23:59:58") != std::string::npos;
+    if (ok) ++passed; else ++failed;
+    std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(24) << std::left << "in-place write" << " => " << got
+              << ", " << changed << " bytes changed" << std::endl;
+
+    // Writing the same time again finds it already set and leaves the file (and its mtime) alone
+    const auto mtimeBefore = std::filesystem::last_write_time(tmp);
+    filetimefixer::ExifSession again;
+    bool rewritten = again.writeTime(tmp.string(), target, alreadySet);
+    ok = rewritten && alreadySet && readBack() == after && std::filesystem::last_write_time(tmp) == mtimeBefore;
+    std::filesystem::remove(tmp);
+    if (ok) ++passed; else ++failed;
+    std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(24) << std::left << "write of same time"
+              << " => " << (alreadySet ? "already set" : "written") << std::endl;
+
+    std::cout << "\nEXIF reader tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// MappedIo behaves as the BasicIo Exiv2 expects: positioned reads, the mapping itself, stores through
+// a writable mapping, and transfer() replacing the file (how Exiv2 saves a rewritten image)
+void runMappedIoTests() {
+    std::cout << "\n========== Memory-mapped Exiv2 io (MappedIo) ==========\n" << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path tmp = fs::temp_directory_path() / "ftf_mapped_io_test.bin";
+    const fs::path moved = fs::temp_directory_path() / "ftf_mapped_io_test_moved.bin";
+    std::vector<uint8_t> bytes(70000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 7);
+    auto writeFile = [](const fs::path& path, const std::vector<uint8_t>& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    };
+    auto readFile = [](const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    writeFile(tmp, bytes);
+    filetimefixer::MappedIo io(tmp.string());
+
+    struct Case {
+        const char* what;
+        std::function<bool()> check;
+    };
+    const std::vector<Case> cases = {
+        { "open and size", [&] { return io.open() == 0 && io.isopen() && io.size() == bytes.size(); } },
+        { "seek and read", [&] {
+            uint8_t buf[5];
+            return io.seek(65536, Exiv2::BasicIo::beg) == 0 && io.read(buf, 5) == 5
+                && std::memcmp(buf, bytes.data() + 65536, 5) == 0 && io.tell() == 65541;
+        } },
+        { "read past end", [&] {
+            Exiv2::DataBuf buf = io.read(10000);
+            return buf.size() == bytes.size() - 65541 && io.eof() && io.getb() == EOF;
+        } },
+        { "huge read is clamped", [&] {
+            Exiv2::DataBuf buf = io.read(std::numeric_limits<size_t>::max() / 2);
+            return buf.size() == 0 && io.eof();  // At the end already: nothing allocated
+        } },
+        { "seek out of range", [&] {
+            return io.seek(-1, Exiv2::BasicIo::beg) != 0 && io.seek(1, Exiv2::BasicIo::end) != 0
+                && io.seek(-2, Exiv2::BasicIo::end) == 0 && io.getb() == bytes[bytes.size() - 2];
+        } },
+        { "mmap is the file", [&] {
+            const Exiv2::byte* view = io.mmap();
+            return view && std::memcmp(view, bytes.data(), bytes.size()) == 0;
+        } },
+        { "store through mmap(true)", [&] {
+            Exiv2::byte* view = io.mmap(true);
+            if (!view) return false;
+            view[100] = static_cast<Exiv2::byte>(~bytes[100]);
+            bool ok = io.munmap() == 0 && io.close() == 0;
+            bytes[100] = static_cast<uint8_t>(~bytes[100]);
+            return ok && readFile(tmp) == bytes;
+        } },
+        { "transfer replaces file", [&] {
+            const std::vector<uint8_t> smaller(bytes.begin(), bytes.begin() + 1234);
+            Exiv2::MemIo src(smaller.data(), smaller.size());
+            io.transfer(src);
+            return !io.isopen() && readFile(tmp) == smaller;
+        } },
+        { "setPath after rename", [&] {
+            std::error_code ec;
+            fs::rename(tmp, moved, ec);
+            io.setPath(moved.string());
+            return !ec && io.open() == 0 && io.size() == 1234 && io.getb() == bytes[0] && io.close() == 0;
+        } },
+    };
+    int passed = 0, failed = 0;
+    for (const auto& c : cases) {
+        bool ok = false;
+        try {
+            ok = c.check();
+        } catch (const Exiv2::Error&) {
+        }
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << c.what << std::endl;
+    }
+    io.close();
+    std::error_code ec;
+    fs::remove(tmp, ec);
+    fs::remove(moved, ec);
+
+    std::cout << "\nMappedIo tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// A bounded pool blocks submit() once its queue is full; an unbounded one (the --video-jobs pool)
+// never does, so images keep flowing to their own pool while every video worker is busy
+void runWorkerPoolTests() {
+    std::cout << "\n========== Worker pools ==========\n" << std::endl;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool released = false;
+    auto gate = [&] {
+        std::unique_lock<std::mutex> lk(mutex);
+        cv.wait(lk, [&] { return released; });
+    };
+    auto release = [&] {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            released = true;
+        }
+        cv.notify_all();
+    };
+    int passed = 0, failed = 0;
+    auto check = [&](bool ok, const char* what) {
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << what << std::endl;
+    };
+
+    {
+        // One busy worker, two waiting slots: the fourth submit waits until the worker is released
+        filetimefixer::WorkStealingPool pool(1, 2);
+        std::atomic<int> submitted{ 0 }, ran{ 0 };
+        std::thread feeder([&] {
+            for (int i = 0; i < 5; ++i) {
+                pool.submit([&] { gate(); ++ran; });
+                ++submitted;
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        check(submitted <= 3, "bounded pool blocks submit when full");
+        release();
+        feeder.join();
+        pool.wait();
+        check(ran == 5, "bounded pool runs every task after release");
+    }
+
+    released = false;
+    {
+        // 300 videos behind one stuck ffmpeg, then a photo folder: more than the default 64 per thread
+        const int videos = 300, images = 200;
+        filetimefixer::WorkStealingPool imagePool(2);
+        filetimefixer::WorkStealingPool videoPool(1, filetimefixer::WorkStealingPool::kUnbounded);
+        std::atomic<int> videosRan{ 0 }, imagesRan{ 0 };
+        std::atomic<bool> scanDone{ false };
+        std::thread scanner([&] {
+            for (int i = 0; i < videos; ++i) videoPool.submit([&] { gate(); ++videosRan; });
+            for (int i = 0; i < images; ++i) imagePool.submit([&] { ++imagesRan; });
+            scanDone = true;
+        });
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while ((!scanDone || imagesRan < images) && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        check(scanDone && videosRan == 0, "video submits do not block the scan");
+        check(imagesRan == images, "images finish while the video queue is full");
+        release();
+        scanner.join();
+        imagePool.wait();
+        videoPool.wait();
+        check(videosRan == videos, "every video runs after release");
+    }
+
+    std::cout << "\nWorker pool tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// --journal / --resume: what an interrupted run left behind is read back, and a torn or corrupt
+// tail (crash mid-write) ends the journal and is cut off when it is reopened
+void runJournalTests() {
+    std::cout << "\n========== Run journal (--journal / --resume) ==========\n" << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path base = fs::temp_directory_path() / "ftf_journal_test_base.ftfj";
+    const fs::path extra = fs::temp_directory_path() / "ftf_journal_test_extra.ftfj";
+    const fs::path work = fs::temp_directory_path() / "ftf_journal_test.ftfj";
+    auto readFile = [](const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    auto writeFile = [](const fs::path& path, const std::string& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+    auto plan = [](const std::string& path, bool isImage, int64_t epochMs, int16_t offsetMinutes) {
+        filetimefixer::MediaPlan p;
+        p.task.path = path;
+        p.isImage = isImage;
+        p.resolved.targetTime.epochMs = epochMs;
+        p.resolved.targetTime.precision = filetimefixer::TimePrecision::Seconds;
+        p.resolved.targetTime.offsetMinutes = offsetMinutes;
+        return p;
+    };
+    const size_t kHeaderSize = 12;  // Magic and version
+
+    // a was renamed only; b finished; c's target was renamed twice, the second (c2) counts
+    std::string error;
+    {
+        filetimefixer::RunJournal journal;
+        journal.open(base, false, error);
+        journal.renamed(plan("d/a.jpg", true, 1688202000000, 120), "d/IMG_1.jpg");
+        journal.renamed(plan("d/b.jpg", true, 1688202001000, 120), "d/IMG_2.jpg");
+        journal.done("d/b.jpg", "d/IMG_2.jpg");
+        journal.renamed(plan("d/c.mp4", false, 1688202002000, 120), "d/VID_3.mp4");
+        journal.renamed(plan("d/c2.mp4", false, 1688202003000, -300), "d/VID_3.mp4");
+        journal.close();
+    }
+    {
+        filetimefixer::RunJournal journal;
+        journal.open(extra, false, error);
+        journal.done("d/z.jpg", "d/IMG_9.jpg");
+        journal.close();
+    }
+    const std::string baseBytes = readFile(base);
+    const std::string record = readFile(extra).substr(kHeaderSize);  // One valid 'D' record
+
+    int passed = 0, failed = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << what << std::endl;
+    };
+    // The state of the base journal, and nothing of what follows a bad record
+    auto recovered = [&](const filetimefixer::RunJournal& journal) {
+        const auto& unfinished = journal.unfinishedRenames();
+        return unfinished.size() == 2 && unfinished[0].from == "d/a.jpg" && unfinished[0].to == "d/IMG_1.jpg"
+            && unfinished[1].from == "d/c2.mp4" && unfinished[1].to == "d/VID_3.mp4" && !unfinished[1].isImage
+            && unfinished[1].targetTime.epochMs == 1688202003000
+            && unfinished[1].targetTime.precision == filetimefixer::TimePrecision::Seconds
+            && unfinished[1].targetTime.offsetMinutes == -300
+            && journal.isDone("d/b.jpg") && journal.isDone("d/IMG_2.jpg") && !journal.isDone("d/z.jpg")
+            && journal.loadedDoneCount() == 1;
+    };
+
+    {
+        filetimefixer::RunJournal journal;
+        bool opened = journal.open(base, true, error);
+        check(opened && recovered(journal), "resume: done files, unfinished renames, last rename per target wins");
+        check(journal.close() && readFile(base) == baseBytes, "resume without new records leaves the file as is");
+    }
+
+    std::string badSum = record;
+    badSum[badSum.size() - 1] ^= 0x01;  // Payload no longer matches its FNV-1a
+    const std::vector<std::pair<const char*, std::string>> tails = {
+        { "torn tail", record.substr(0, record.size() - 3) },
+        { "bad checksum", badSum + record },
+        { "zero length", std::string(8, '\0') + record },
+    };
+    for (const auto& [what, tail] : tails) {
+        writeFile(work, baseBytes + tail);
+        filetimefixer::RunJournal journal;
+        bool opened = journal.open(work, true, error);
+        check(opened && recovered(journal), std::string(what) + ": load stops at the bad record");
+        bool closed = journal.close();
+        check(closed && fs::file_size(work) == baseBytes.size(), std::string(what) + ": cut off on reopen");
+    }
+
+    // Records appended after the cut are read back by the next resume
+    {
+        filetimefixer::RunJournal journal;
+        journal.open(work, true, error);
+        journal.done("d/a.jpg", "d/IMG_1.jpg");
+        journal.close();
+        filetimefixer::RunJournal reopened;
+        bool opened = reopened.open(work, true, error);
+        check(opened && reopened.isDone("d/IMG_1.jpg") && reopened.unfinishedRenames().size() == 1
+                  && reopened.unfinishedRenames()[0].to == "d/VID_3.mp4",
+              "append after the cut, done drops the rename");
+    }
+
+    std::error_code ec;
+    fs::remove(base, ec);
+    fs::remove(extra, ec);
+    fs::remove(work, ec);
+    std::cout << "\nJournal tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// --plan / --apply: every field of a record comes back as written, including the time precision
+// and offset and the planned source's identity; a cut-off record or another plan version is an error
+void runPlanFileTests() {
+    std::cout << "\n========== Plan file (--plan / --apply) ==========\n" << std::endl;
+    namespace fs = std::filesystem;
+    const fs::path source = fs::temp_directory_path() / "ftf_plan_test_source.jpg";
+    const fs::path planPath = fs::temp_directory_path() / "ftf_plan_test.ftfplan";
+    const fs::path damaged = fs::temp_directory_path() / "ftf_plan_test_damaged.ftfplan";
+    auto readFile = [](const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    auto writeFile = [](const fs::path& path, const std::string& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+    writeFile(source, "not really a jpeg");
+
+    filetimefixer::MediaPlan image;
+    image.task = filetimefixer::MediaTask{ source, 7, 3 };
+    image.isImage = true;
+    image.resolved.scenario = filetimefixer::TargetTimeScenario::BothUseEarliest;
+    image.resolved.targetTime.epochMs = 1688202000123;
+    image.resolved.targetTime.precision = filetimefixer::TimePrecision::Milliseconds;
+    image.resolved.targetTime.offsetMinutes = 120;
+    image.targetFileName = "IMG_20230701_110000.jpg";
+    filetimefixer::MediaPlan video;  // Source gone by the time the plan is written
+    video.task = filetimefixer::MediaTask{ fs::temp_directory_path() / "ftf_plan_test_missing.mp4", 8, 4 };
+    video.resolved.scenario = filetimefixer::TargetTimeScenario::NameOnly;
+    video.resolved.targetTime.epochMs = -86400000;
+    video.resolved.targetTime.precision = filetimefixer::TimePrecision::Date;
+    video.resolved.targetTime.offsetMinutes = -330;
+    video.targetFileName = "VID_19691231_000000.mp4";
+    {
+        filetimefixer::PlanWriter writer;
+        writer.open(planPath, "/photos");
+        writer.append(image);
+        writer.append(video);
+        writer.close();
+    }
+    filetimefixer::FileKey sourceKey;
+    filetimefixer::statFileKey(source, sourceKey);
+
+    auto same = [](const filetimefixer::MediaPlan& a, const filetimefixer::MediaPlan& b) {
+        return a.task.path == b.task.path && a.task.fileIndex == b.task.fileIndex && a.task.logSeq == b.task.logSeq
+            && a.isImage == b.isImage && a.resolved.scenario == b.resolved.scenario
+            && a.resolved.targetTime.epochMs == b.resolved.targetTime.epochMs
+            && a.resolved.targetTime.precision == b.resolved.targetTime.precision
+            && a.resolved.targetTime.offsetMinutes == b.resolved.targetTime.offsetMinutes
+            && a.targetFileName == b.targetFileName;
+    };
+    int passed = 0, failed = 0;
+    auto check = [&](bool ok, const char* what) {
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << what << std::endl;
+    };
+
+    {
+        filetimefixer::PlanReader reader;
+        std::string error;
+        filetimefixer::MediaPlan a, b, c;
+        bool opened = reader.open(planPath, error);
+        check(opened && reader.rootDirectory() == "/photos", "header and root directory");
+        check(reader.next(a) && same(a, image) && a.plannedSource && *a.plannedSource == sourceKey,
+              "image record with time precision, offset and planned source");
+        check(reader.next(b) && same(b, video) && !b.plannedSource, "video record without a source");
+        check(!reader.next(c) && reader.error().empty(), "end of plan is not an error");
+    }
+
+    const std::string bytes = readFile(planPath);
+    {
+        writeFile(damaged, bytes.substr(0, bytes.size() - 5));
+        filetimefixer::PlanReader reader;
+        std::string error;
+        filetimefixer::MediaPlan a, b;
+        bool opened = reader.open(damaged, error);
+        check(opened && reader.next(a) && same(a, image) && !reader.next(b) && reader.error() == "Truncated plan record",
+              "cut-off last record is reported");
+    }
+    {
+        writeFile(damaged, bytes + "\x01\x02");
+        filetimefixer::PlanReader reader;
+        std::string error;
+        filetimefixer::MediaPlan a, b, c;
+        bool opened = reader.open(damaged, error);
+        check(opened && reader.next(a) && reader.next(b) && !reader.next(c) && reader.error() == "Truncated plan record",
+              "stray bytes after the last record are reported");
+    }
+    {
+        std::string older = bytes;
+        older[8] = 2;  // Version field after the magic
+        writeFile(damaged, older);
+        filetimefixer::PlanReader reader;
+        std::string error;
+        check(!reader.open(damaged, error) && error == "Unsupported plan version 2", "other plan version is refused");
+    }
+
+    std::error_code ec;
+    fs::remove(source, ec);
+    fs::remove(planPath, ec);
+    fs::remove(damaged, ec);
+    std::cout << "\nPlan file tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// CivilTime must agree with libc gmtime / timegm on every day of the range libc supports here
+void runCivilTimeTests() {
+    std::cout << "\n========== Civil calendar (CivilTime) vs libc ==========\n" << std::endl;
+#ifdef _WIN32
+    const int64_t firstYear = 1970, lastYear = 2999;  // _mkgmtime / gmtime_s range
+#else
+    const int64_t firstYear = 1, lastYear = 9999;
+#endif
+    const int64_t firstDay = filetimefixer::daysFromCivil(firstYear, 1, 1);
+    const int64_t lastDay = filetimefixer::daysFromCivil(lastYear, 12, 31);
+    int passed = 0, failed = 0;
+    size_t mismatches = 0;
+    uint32_t seed = 2024;
+    for (int64_t day = firstDay; day <= lastDay; ++day) {
+        seed = seed * 1103515245u + 12345u;
+        int64_t seconds = day * filetimefixer::kSecondsPerDay + (seed >> 8) % filetimefixer::kSecondsPerDay;
+        filetimefixer::CivilDateTime c = filetimefixer::epochSecondsToCivil(seconds);
+        std::time_t t = static_cast<std::time_t>(seconds);
+        std::tm tm = {};
+#ifdef _WIN32
+        bool libcOk = gmtime_s(&tm, &t) == 0;
+#else
+        bool libcOk = gmtime_r(&t, &tm) != nullptr;
+#endif
+        bool same = libcOk && c.year == tm.tm_year + 1900 && c.month == tm.tm_mon + 1 && c.day == tm.tm_mday
+            && c.hour == tm.tm_hour && c.minute == tm.tm_min && c.second == tm.tm_sec;
+#ifdef _WIN32
+        same = same && _mkgmtime(&tm) == t;
+#else
+        same = same && timegm(&tm) == t;
+#endif
+        same = same && filetimefixer::civilToEpochSeconds(c) == seconds
+            && filetimefixer::isValidCivilDate(c.year, c.month, c.day)
+            && filetimefixer::daysInMonth(c.year, c.month) == filetimefixer::epochSecondsToCivil(
+                (filetimefixer::daysFromCivil(c.year, c.month, 1) + filetimefixer::daysInMonth(c.year, c.month) - 1)
+                * filetimefixer::kSecondsPerDay).day;
+        if (!same && ++mismatches <= 5)
+            std::cout << "[FAIL] " << seconds << " => " << c.year << "-" << c.month << "-" << c.day << " " << c.hour
+                      << ":" << c.minute << ":" << c.second << std::endl;
+    }
+    if (mismatches == 0) ++passed; else ++failed;
+    std::cout << (mismatches == 0 ? "[PASS]" : "[FAIL]") << " years " << firstYear << ".." << lastYear << ": "
+              << (lastDay - firstDay + 1) << " days, " << mismatches << " mismatches" << std::endl;
+
+    const bool leapOk = filetimefixer::isLeapYear(2000) && !filetimefixer::isLeapYear(1900)
+        && filetimefixer::isLeapYear(2024) && !filetimefixer::isValidCivilDate(2023, 2, 29)
+        && filetimefixer::isValidCivilDate(2024, 2, 29) && !filetimefixer::isValidCivilDate(2024, 13, 1);
+    if (leapOk) ++passed; else ++failed;
+    std::cout << (leapOk ? "[PASS]" : "[FAIL]") << " leap years and month lengths" << std::endl;
+    std::cout << "\nCivilTime tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// parseFileNameTimes must agree with scanFileNameTime on every instruction set this CPU supports
+void runFileNameBatchTests() {
+    std::cout << "\n========== Batch file name parse (parseFileNameTimes) ==========\n" << std::endl;
+    std::vector<std::string> names = {
+        "IMG_20231111_193849.jpg", "pt2021_10_23_21_52_39.jpg", "Screenshot_2021-03-25-01-12-43-235_com.tencent.mm.jpg",
+        "mmexport1568301595980.jpg", "1605199092110.jpeg", "20220115-wczt.jpg", "DSC_0001.JPG", "nonsense.txt",
+        "IMG_20231311_193849.jpg", "a_very_long_name_that_goes_past_sixty_four_bytes_before_the_date_20240807_123043.jpg",
+    };
+    // Random names over an alphabet dense in digits and separators, so many candidates are near misses
+    const std::string alphabet = "0123456789012345678901_-.ptIMGScreenshot";
+    uint32_t seed = 12345;
+    for (int i = 0; i < 20000; ++i) {
+        std::string name;
+        seed = seed * 1103515245u + 12345u;
+        size_t length = 4 + (seed >> 16) % 70;
+        for (size_t k = 0; k < length; ++k) {
+            seed = seed * 1103515245u + 12345u;
+            name += alphabet[(seed >> 16) % alphabet.size()];
+        }
+        names.push_back(name + ".jpg");
+    }
+    std::vector<std::string_view> views(names.begin(), names.end());
+    std::vector<filetimefixer::FileNameTime> times(views.size());
+
+    auto format = [](const filetimefixer::FileNameTime& t, bool found) {
+        char buf[filetimefixer::kFileNameTimeMaxLength];
+        return found ? std::string(buf, filetimefixer::formatFileNameTime(t, buf)) : std::string();
+    };
+    std::string defaultIsa = filetimefixer::fileNameBatchIsa();
+    int passed = 0, failed = 0;
+    for (const char* isa : { "scalar", "sse4.2", "avx2" }) {
+        if (!filetimefixer::selectFileNameBatchIsa(isa)) {
+            std::cout << "[SKIP] " << isa << " (not supported here)" << std::endl;
+            continue;
+        }
+        size_t found = filetimefixer::parseFileNameTimes(views, times);
+        size_t expectedFound = 0, mismatches = 0;
+        for (size_t i = 0; i < views.size(); ++i) {
+            filetimefixer::FileNameTime t;
+            bool ok = filetimefixer::scanFileNameTime(views[i], t);
+            if (ok) ++expectedFound;
+            if (format(t, ok) != format(times[i], times[i].year != 0)) ++mismatches;
+        }
+        bool ok = mismatches == 0 && found == expectedFound;
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(8) << std::left << isa << " " << views.size()
+                  << " names, " << found << " found, " << mismatches << " mismatches" << std::endl;
+    }
+    filetimefixer::selectFileNameBatchIsa(defaultIsa);
+    std::cout << "\nBatch parse tests (" << defaultIsa << " by default): " << passed << " passed, " << failed
+              << " failed.\n" << std::endl;
+}
+
+// User patterns (--patterns): matched before the built-in layouts, winner reported by name
+void runFileNamePatternTests() {
+    std::cout << "\n========== User filename patterns (FileNamePatternSet) ==========\n" << std::endl;
+    auto patterns = std::make_shared<filetimefixer::FileNamePatternSet>();
+    std::string error;
+    bool built = patterns->add("dji", "DJI_{Y4}{M2}{D2}{h2}{m2}{s2}", error)
+        && patterns->add("whatsapp", "IMG-{Y4}{M2}{D2}-WA{#}{#}{#}{#}", error)
+        && patterns->add("dotted", "{D2}.{M2}.{Y4} {h2}.{m2}.{s2}.{ms3}", error)
+        && patterns->add("", "{{{Y4}{M2}{D2}}}", error)
+        && patterns->compile(error);
+    if (!built) {
+        std::cout << "[FAIL] build patterns: " << error << "\n\nPattern tests: 0 passed, 1 failed.\n" << std::endl;
+        return;
+    }
+    filetimefixer::setUserFileNamePatterns(patterns);
+
+    struct Case { std::string filename; std::string expectedTime; std::string expectedPattern; };
+    std::vector<Case> cases = {
+        { "DJI_20230101123456_0001.JPG", "2023-01-01 12:34:56", "dji" },
+        { "IMG-20230215-WA0007.jpg", "2023-02-15", "whatsapp" },
+        { "Photo 05.06.2022 07.08.09.123.jpg", "2022-06-05 07:08:09.123", "dotted" },
+        { "scan {20191231}.png", "2019-12-31", "{{{Y4}{M2}{D2}}}" },
+        { "DJI_20231301123456_0001.JPG", "", "" },        // Invalid month: no user match, built-ins find nothing
+        { "IMG-20230230-WA0001.jpg", "", "" },            // Feb 30
+        { "IMG_20231111_193849.jpg", "2023-11-11 19:38:49", "" },  // Built-in layout
+    };
+    int passed = 0, failed = 0;
+    for (const auto& c : cases) {
+        std::string pattern;
+        filetimefixer::FileNameTime t;
+        char buf[filetimefixer::kFileNameTimeMaxLength];
+        std::string got = filetimefixer::findFileNameTime(c.filename, t, pattern)
+            ? std::string(buf, filetimefixer::formatFileNameTime(t, buf)) : "";
+        bool ok = (got == c.expectedTime && pattern == c.expectedPattern);
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(40) << std::left << c.filename
+                  << " => " << (got.empty() ? "(empty)" : got) << (pattern.empty() ? "" : " [" + pattern + "]");
+        if (!ok) std::cout << "  (expected: " << (c.expectedTime.empty() ? "(empty)" : c.expectedTime) << ")";
+        std::cout << std::endl;
+    }
+
+    std::vector<std::string> invalid = { "{Y4}{M2}", "IMG_{Y4}{M2}{D2}_{m2}", "{Y4}{M2}{D2}{X9}", "{Y4}{M2}{D2}{Y4}", "{Y4}{M2}{D2}}" };
+    for (const auto& text : invalid) {
+        filetimefixer::FileNamePatternSet set;
+        bool ok = !set.add("", text, error);
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " rejected " << std::setw(31) << std::left << text
+                  << " => " << (ok ? error : "(accepted)") << std::endl;
+    }
+    filetimefixer::setUserFileNamePatterns(nullptr);
+    std::cout << "\nPattern tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
+// Layout hit statistics and --adaptive-layouts: after training on skewed name mixes, the hot-layout
+// probes must give exactly what the fixed-order scan gives, time and layout
+void runFileNameLayoutTests() {
+    std::cout << "\n========== Filename layout statistics (adaptive order) ==========\n" << std::endl;
+    uint32_t seed = 777;
+    auto next = [&seed](uint32_t n) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 16) % n;
+    };
+    auto digits = [&next](size_t n) {
+        std::string d;
+        for (size_t k = 0; k < n; ++k) d += static_cast<char>('0' + next(10));
+        return d;
+    };
+    auto two = [&next](uint32_t limit) {
+        uint32_t v = next(limit);
+        return std::string(1, static_cast<char>('0' + v / 10)) + static_cast<char>('0' + v % 10);
+    };
+    auto date8 = [&]() { return "20" + two(30) + two(13) + two(32); };  // Some months / days out of range
+    // One generator per source; each mix below draws mostly from one of them
+    const std::vector<std::function<std::string()>> sources = {
+        [&]() { return "IMG_" + date8() + "_" + two(25) + two(60) + two(60) + ".jpg"; },
+        [&]() { return "pt20" + two(30) + "_" + two(13) + "_" + two(32) + "_" + two(24) + "_" + two(60) + "_" + two(60) + ".jpg"; },
+        [&]() { return "Screenshot_20" + two(30) + "-" + two(13) + "-" + two(32) + "-" + two(24) + "-" + two(60) + "-"
+                       + two(60) + "-" + digits(3) + "_com.tencent.mm.jpg"; },
+        [&]() { return date8() + (next(2) ? "-wczt.jpg" : "_" + digits(next(5)) + ".png"); },
+        [&]() { return (next(2) ? "mmexport" : "") + (next(4) ? "1" + digits(12) : date8() + digits(5)) + ".jpg"; },
+        [&]() { return "wx_camera_" + digits(10) + ".mp4"; },
+    };
+    const std::string alphabet = "0123456789012345678901_-.ptIMGScreenshot";
+    auto nearMiss = [&]() {
+        std::string name;
+        for (size_t k = 4 + next(40); k > 0; --k) name += alphabet[next(static_cast<uint32_t>(alphabet.size()))];
+        return name + (next(2) ? ".jpg" : "");
+    };
+
+    int passed = 0, failed = 0;
+    filetimefixer::resetFileNameLayoutStats();
+    filetimefixer::setAdaptiveFileNameLayouts(true);
+    uint64_t lookups = 0;
+    for (size_t hot = 0; hot < sources.size(); ++hot) {
+        const filetimefixer::FileNameLayoutStats before = filetimefixer::fileNameLayoutStats();
+        size_t mismatches = 0;
+        const size_t kNames = 8192;
+        for (size_t i = 0; i < kNames; ++i) {
+            uint32_t pick = next(20);
+            std::string name = pick < 14 ? sources[hot]() : pick < 18 ? sources[next(static_cast<uint32_t>(sources.size()))]() : nearMiss();
+            filetimefixer::FileNameTime expected, got;
+            filetimefixer::FileNameLayout layout;
+            bool expectedFound = filetimefixer::scanFileNameTime(name, expected, layout);
+            std::string pattern;
+            bool found = filetimefixer::findFileNameTime(name, got, pattern);
+            char a[filetimefixer::kFileNameTimeMaxLength], b[filetimefixer::kFileNameTimeMaxLength];
+            if (found != expectedFound
+                || (found && std::string(a, filetimefixer::formatFileNameTime(expected, a))
+                                 != std::string(b, filetimefixer::formatFileNameTime(got, b)))) {
+                if (mismatches++ < 3) std::cout << "  mismatch: " << name << std::endl;
+            }
+        }
+        lookups += kNames;
+        const filetimefixer::FileNameLayoutStats after = filetimefixer::fileNameLayoutStats();
+        uint64_t counted = 0;
+        for (uint64_t hits : after.hits) counted += hits;
+        bool ok = mismatches == 0 && counted == lookups;
+        if (ok) ++passed; else ++failed;
+        std::cout << (ok ? "[PASS]" : "[FAIL]") << " mix " << hot << ": " << kNames << " names, " << mismatches
+                  << " mismatches, " << (after.probeHits - before.probeHits) << " by probe" << std::endl;
+    }
+
+    // Per-layout counts match the fixed-order scan's own classification
+    filetimefixer::resetFileNameLayoutStats();
+    const std::vector<std::pair<std::string, filetimefixer::FileNameLayout>> named = {
+        { "IMG_20231111_193849.jpg", filetimefixer::FileNameLayout::DateTime },
+        { "pt2021_10_23_21_52_39.jpg", filetimefixer::FileNameLayout::Pt },
+        { "Screenshot_2021-03-25-01-12-43-235_com.tencent.mm.jpg", filetimefixer::FileNameLayout::Screenshot },
+        { "20220115-wczt.jpg", filetimefixer::FileNameLayout::Date8 },
+        { "mmexport1568301595980.jpg", filetimefixer::FileNameLayout::Timestamp },
+        { "DSC_0001.JPG", filetimefixer::FileNameLayout::NotFound },
+    };
+    for (int round = 0; round < 2; ++round) {
+        for (const auto& [name, layout] : named) {
+            filetimefixer::FileNameTime t;
+            filetimefixer::FileNameLayout scanned;
+            std::string pattern;
+            filetimefixer::scanFileNameTime(name, t, scanned);
+            filetimefixer::findFileNameTime(name, t, pattern);
+            if (round == 1) {
+                bool ok = scanned == layout;
+                if (ok) ++passed; else ++failed;
+                std::cout << (ok ? "[PASS]" : "[FAIL]") << " " << std::setw(40) << std::left << name << " => "
+                          << filetimefixer::fileNameLayoutName(scanned) << std::endl;
+            }
+        }
+    }
+    const filetimefixer::FileNameLayoutStats stats = filetimefixer::fileNameLayoutStats();
+    bool countsOk = true;
+    for (const auto& [name, layout] : named) countsOk = countsOk && stats.hits[static_cast<size_t>(layout)] == 2;
+    if (countsOk) ++passed; else ++failed;
+    std::cout << (countsOk ? "[PASS]" : "[FAIL]") << " two hits counted per layout" << std::endl;
+
+    filetimefixer::setAdaptiveFileNameLayouts(false);
+    filetimefixer::resetFileNameLayoutStats();
+    std::cout << "\nLayout statistics tests: " << passed << " passed, " << failed << " failed.\n" << std::endl;
+}
+
 void printScenarioTable() {
     std::cout << "\n========== Target time resolver scenarios ==========\n" << std::endl;
     std::cout << "| Scenario | Description |" << std::endl;
@@ -138,6 +1042,17 @@ int runAllTests() {
     runFileNameTests();
     runResolverTests();
     runExifFormatTests();
+    runExifReaderTests();
+    runMappedIoTests();
+    runWorkerPoolTests();
+    runJournalTests();
+    runPlanFileTests();
+    runTimeValueTests();
+    runCivilTimeTests();
+    runTimeZoneTests();
+    runFileNameBatchTests();
+    runFileNamePatternTests();
+    runFileNameLayoutTests();
     std::cout << "Done." << std::endl;
     return 0;
 }
@@ -1,112 +1,197 @@
 #include "TimeConvert.h"
 #include "TimeParse.h"
-#include <chrono>
-#include <iomanip>
-#include <sstream>
-#ifdef _WIN32
-#include <time.h>
-#else
-#include <ctime>
-#endif
+#include "CivilTime.h"
 
 namespace filetimefixer {
 
-bool parseUTCStringToTm(std::tm& tm, const std::string& utcTimeStr) {
-    std::istringstream ss(utcTimeStr);
-    if (utcTimeStr.empty()) return false;
-    if (utcTimeStr.find('T') != std::string::npos && utcTimeStr.find('-') != std::string::npos) {
-        ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-        if (!ss.fail()) return true;
-    }
-    if (utcTimeStr.find('-') != std::string::npos) {
-        ss.clear();
-        ss.str(utcTimeStr);
-        ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-        if (!ss.fail()) return true;
-    }
-    if (utcTimeStr.find(':') != std::string::npos) {
-        ss.clear();
-        ss.str(utcTimeStr);
-        ss >> std::get_time(&tm, "%Y:%m:%d %H:%M:%S");
-        if (!ss.fail()) return true;
+namespace {
+
+FileNameTime wallTimeAtOffset(const TimeValue& value, int64_t offsetSeconds) {
+    FileNameTime wall;
+    int64_t seconds = value.epochSeconds();
+    if (value.empty()) return wall;
+    CivilDateTime c = epochSecondsToCivil(seconds + offsetSeconds);
+    wall.year = static_cast<int>(c.year);
+    wall.month = c.month;
+    wall.day = c.day;
+    wall.hour = c.hour;
+    wall.minute = c.minute;
+    wall.second = c.second;
+    wall.millis = static_cast<int>(value.epochMs - seconds * 1000);
+    wall.hasTime = value.hasTimeOfDay();
+    wall.hasMillis = value.precision == TimePrecision::Milliseconds;
+    return wall;
+}
+
+}  // namespace
+
+bool parseFixedLayoutTime(std::string_view text, FileNameTime& out) {
+    const size_t n = text.size();
+    if (n != 10 && n < 19) return false;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    // Every digit position and separator folds into one flag; no early exits until the end
+    unsigned bad = 0;
+    auto digit = [p, &bad](size_t i) {
+        unsigned v = p[i] - static_cast<unsigned>('0');
+        bad |= v > 9;
+        return static_cast<int>(v);
+    };
+    const unsigned char sep = p[4];
+    bad |= (sep != '-' && sep != ':') | (p[7] != sep);
+    FileNameTime t;
+    t.year = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+    t.month = digit(5) * 10 + digit(6);
+    t.day = digit(8) * 10 + digit(9);
+    if (n >= 19) {
+        bad |= (p[10] != 'T' && p[10] != ' ') | (p[13] != ':') | (p[16] != ':');
+        t.hour = digit(11) * 10 + digit(12);
+        t.minute = digit(14) * 10 + digit(15);
+        t.second = digit(17) * 10 + digit(18);
+        t.hasTime = true;
+        if (n >= 23 && p[19] == '.') {
+            t.millis = digit(20) * 100 + digit(21) * 10 + digit(22);
+            t.hasMillis = true;
+        }
     }
-    return false;
+    if (bad || !isValidFileNameTime(t)) return false;
+    out = t;
+    return true;
+}
+
+bool parseUTCStringToTm(std::tm& tm, const std::string& utcTimeStr) {
+    FileNameTime t;
+    if (!parseFixedLayoutTime(utcTimeStr, t) || !t.hasTime) return false;
+    tm.tm_year = t.year - 1900;
+    tm.tm_mon = t.month - 1;
+    tm.tm_mday = t.day;
+    tm.tm_hour = t.hour;
+    tm.tm_min = t.minute;
+    tm.tm_sec = t.second;
+    return true;
 }
 
 std::time_t utcStringToTimestamp(const std::string& timeStr) {
-    std::tm tm = {};
-    if (!parseUTCStringToTm(tm, timeStr)) return static_cast<time_t>(-1);
-    tm.tm_isdst = 0;
-#ifdef _WIN32
-    return _mkgmtime(&tm);
-#else
-    return timegm(&tm);
-#endif
+    FileNameTime t;
+    if (!parseFixedLayoutTime(timeStr, t) || !t.hasTime) return static_cast<time_t>(-1);
+    CivilDateTime c;
+    c.year = t.year;
+    c.month = t.month;
+    c.day = t.day;
+    c.hour = t.hour;
+    c.minute = t.minute;
+    c.second = t.second;
+    return static_cast<std::time_t>(civilToEpochSeconds(c));
+}
+
+size_t formatUtcIsoTime(int64_t epochSeconds, char* buf) {
+    TimeValue value;
+    value.epochMs = epochSeconds * 1000;
+    value.precision = TimePrecision::Seconds;
+    return formatIsoTime(wallTime(value, 0), buf);
 }
 
 std::string timestampToUTCString(std::time_t timestamp) {
-    std::tm tm;
-#ifdef _WIN32
-    gmtime_s(&tm, &timestamp);
-#else
-    gmtime_r(&timestamp, &tm);
-#endif
-    std::ostringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return ss.str();
-}
-
-std::string exifDateTimeToUTCString(const std::string& exifDateTime) {
-    std::tm tm = {};
-    if (!parseUTCStringToTm(tm, exifDateTime)) return "";
-    tm.tm_isdst = -1;
-    std::time_t localTime = std::mktime(&tm);
-    localTime += 8 * 3600;
-    if (localTime == -1) return "";
-    std::ostringstream utcSs;
-#ifdef _WIN32
-    std::tm utcTm = {};
-    if (gmtime_s(&utcTm, &localTime) != 0) return "";
-    utcSs << std::put_time(&utcTm, "%Y-%m-%dT%H:%M:%S");
-#else
-    std::tm* utcTmP = std::gmtime(&localTime);
-    if (!utcTmP) return "";
-    utcSs << std::put_time(utcTmP, "%Y-%m-%dT%H:%M:%S");
-#endif
-    return utcSs.str();
-}
-
-std::string formatTimeToUTC8Name(const std::string& timeStr) {
-    std::tm tm = {};
-    if (!parseUTCStringToTm(tm, timeStr)) return "";
-    tm.tm_isdst = -1;
-    std::time_t localTime = std::mktime(&tm);
-    if (localTime == -1) return "";
-    localTime += 8 * 3600;
-    std::ostringstream utcPlus8Ss;
-#ifdef _WIN32
-    std::tm utcPlus8Tm = {};
-    if (gmtime_s(&utcPlus8Tm, &localTime) != 0) return "";
-    utcPlus8Ss << std::put_time(&utcPlus8Tm, "%Y%m%d_%H%M%S");
-#else
-    std::tm* utcPlus8Tm = std::gmtime(&localTime);
-    if (!utcPlus8Tm) return "";
-    utcPlus8Ss << std::put_time(utcPlus8Tm, "%Y%m%d_%H%M%S");
-#endif
-    if (timeStr.length() >= 23) {
-        std::string msStr = timeStr.substr(20, 3);
-        int ms = std::stoi(msStr);
-        utcPlus8Ss << "_" << std::setw(3) << std::setfill('0') << ms;
+    char buf[kIsoTimeLength];
+    return std::string(buf, formatUtcIsoTime(static_cast<int64_t>(timestamp), buf));
+}
+
+TimeValue timeValueFromWall(const FileNameTime& wall, int offsetMinutes) {
+    if (!isValidFileNameTime(wall)) return {};
+    CivilDateTime c;
+    c.year = wall.year;
+    c.month = wall.month;
+    c.day = wall.day;
+    if (wall.hasTime) {
+        c.hour = wall.hour;
+        c.minute = wall.minute;
+        c.second = wall.second;
     }
-    return utcPlus8Ss.str();
+    TimeValue value;
+    value.epochMs = (civilToEpochSeconds(c) - offsetMinutes * 60) * 1000 + (wall.hasMillis ? wall.millis : 0);
+    value.precision = !wall.hasTime ? TimePrecision::Date
+        : wall.hasMillis ? TimePrecision::Milliseconds : TimePrecision::Seconds;
+    value.offsetMinutes = static_cast<int16_t>(offsetMinutes);
+    return value;
+}
+
+TimeValue timeValueFromWall(const FileNameTime& wall, const TimeZone& zone) {
+    TimeValue value = timeValueFromWall(wall, 0);
+    if (value.empty()) return value;
+    const int64_t local = value.epochSeconds();
+    const int64_t utc = zone.toUtc(local);
+    value.epochMs -= (local - utc) * 1000;
+    // Offset in effect at the instant (differs from local - utc for a wall time in a DST gap)
+    value.offsetMinutes = static_cast<int16_t>(zone.offsetSecondsAt(utc) / 60);
+    return value;
+}
+
+FileNameTime wallTime(const TimeValue& value, int offsetMinutes) {
+    return wallTimeAtOffset(value, offsetMinutes * 60);
+}
+
+FileNameTime wallTime(const TimeValue& value, const TimeZone& zone) {
+    return wallTimeAtOffset(value, zone.offsetSecondsAt(value.epochSeconds()));
+}
+
+TimeValue inTimeZone(const TimeValue& value, const TimeZone& zone) {
+    if (value.empty()) return value;
+    TimeValue out = value;
+    out.offsetMinutes = static_cast<int16_t>(zone.offsetSecondsAt(value.epochSeconds()) / 60);
+    return out;
+}
+
+TimeValue parseTimeValue(const std::string& text, int offsetMinutes) {
+    FileNameTime wall;
+    if (!parseFixedLayoutTime(text, wall)) return {};
+    return timeValueFromWall(wall, offsetMinutes);
+}
+
+TimeValue parseTimeValue(const std::string& text, const TimeZone& zone) {
+    FileNameTime wall;
+    if (!parseFixedLayoutTime(text, wall)) return {};
+    return timeValueFromWall(wall, zone);
+}
+
+TimeValue exifDateTimeToTimeValue(const std::string& exifDateTime, const TimeZone& zone) {
+    return parseTimeValue(exifDateTime, zone);
+}
+
+std::string formatTimeValue(const TimeValue& value) {
+    if (value.empty()) return "";
+    char buf[kFileNameTimeMaxLength + 6];
+    char* p = buf + formatFileNameTime(wallTime(value, value.offsetMinutes), buf);
+    if (value.hasTimeOfDay()) {
+        int offset = value.offsetMinutes < 0 ? -value.offsetMinutes : value.offsetMinutes;
+        *p++ = value.offsetMinutes < 0 ? '-' : '+';
+        p = detail::putDigits2(p, offset / 60 % 100);
+        *p++ = ':';
+        p = detail::putDigits2(p, offset % 60);
+    }
+    return std::string(buf, p);
+}
+
+size_t formatTimeToLocalName(const TimeValue& value, char* buf) {
+    if (value.empty()) return 0;
+    return formatNameStem(wallTime(value, value.offsetMinutes), buf);
+}
+
+std::string formatTimeToLocalName(const TimeValue& value) {
+    char buf[kNameStemMaxLength];
+    return std::string(buf, formatTimeToLocalName(value, buf));
+}
+
+size_t formatTimeForExif(const TimeValue& value, char* buf) {
+    if (value.empty()) return 0;
+    return formatExifTime(wallTime(value, value.offsetMinutes), buf);
 }
 
-std::string supplementDateWithCurrentUtcTime(const std::string& timeStr) {
-    if (timeStr.empty() || timeStr.length() > 10) return timeStr;
-    std::time_t now = std::time(nullptr);
-    std::string utc = timestampToUTCString(now);
-    if (utc.length() < 19) return timeStr;
-    return timeStr + "T" + utc.substr(11, 8);
+TimeValue supplementDateWithCurrentUtcTime(const TimeValue& value) {
+    if (value.precision != TimePrecision::Date) return value;
+    int64_t secondOfDay = static_cast<int64_t>(std::time(nullptr)) % 86400;
+    TimeValue out = value;
+    out.epochMs += secondOfDay * 1000;
+    out.precision = TimePrecision::Seconds;
+    return out;
 }
 
 }  // namespace filetimefixer
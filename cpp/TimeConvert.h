@@ -1,10 +1,20 @@
 #pragma once
 
+#include "TimeFormat.h"
+#include "TimeParse.h"
+#include "TimeValue.h"
+#include "TimeZone.h"
 #include <ctime>
 #include <string>
+#include <string_view>
 
 namespace filetimefixer {
 
+// Fixed-layout time in one validating pass: "YYYY-MM-DDTHH:MM:SS", "YYYY-MM-DD HH:MM:SS" or
+// "YYYY:MM:DD HH:MM:SS", optionally followed by ".mmm"; other trailing text (e.g. ffprobe's "Z") is
+// ignored. A string of exactly "YYYY-MM-DD" / "YYYY:MM:DD" is date-only (hasTime false).
+bool parseFixedLayoutTime(std::string_view text, FileNameTime& out);
+
 // Parse UTC/EXIF time string into tm ("YYYY-MM-DDTHH:MM:SS", "YYYY-MM-DD HH:MM:SS", "YYYY:MM:DD HH:MM:SS")
 bool parseUTCStringToTm(std::tm& tm, const std::string& utcTimeStr);
 
@@ -13,14 +23,45 @@ std::time_t utcStringToTimestamp(const std::string& timeStr);
 
 // time_t -> UTC string "YYYY-MM-DDTHH:MM:SS"
 std::string timestampToUTCString(std::time_t timestamp);
+// Same into buf (kIsoTimeLength chars); returns the length written
+size_t formatUtcIsoTime(int64_t epochSeconds, char* buf);
+
+// Wall-clock fields read in a zone with the given UTC offset -> TimeValue (precision from
+// hasTime / hasMillis). Empty value if the fields are not a valid date/time.
+TimeValue timeValueFromWall(const FileNameTime& wall, int offsetMinutes);
+// Same for a wall clock of zone; offsetMinutes is the zone's offset at that time
+TimeValue timeValueFromWall(const FileNameTime& wall, const TimeZone& zone);
+
+// Fields of value on the wall clock of the given zone (hasTime / hasMillis from its precision)
+FileNameTime wallTime(const TimeValue& value, int offsetMinutes);
+FileNameTime wallTime(const TimeValue& value, const TimeZone& zone);
+
+// The same instant carrying zone's offset at that time, so it is named and written on that wall clock
+TimeValue inTimeZone(const TimeValue& value, const TimeZone& zone);
+
+// "YYYY-MM-DD", "YYYY-MM-DDTHH:MM:SS", "YYYY-MM-DD HH:MM:SS" or "YYYY:MM:DD HH:MM:SS", optionally
+// with ".mmm", read as wall clock of the given zone. Empty value on failure.
+TimeValue parseTimeValue(const std::string& text, int offsetMinutes);
+TimeValue parseTimeValue(const std::string& text, const TimeZone& zone);
+
+// EXIF DateTime ("YYYY:MM:DD HH:MM:SS", wall clock of zone) -> TimeValue; empty value on failure
+TimeValue exifDateTimeToTimeValue(const std::string& exifDateTime, const TimeZone& zone = localTimeZone());
+
+// For output: "YYYY-MM-DD HH:MM:SS[.mmm]+08:00" in the value's own zone, "YYYY-MM-DD" if date-only,
+// "" if empty
+std::string formatTimeValue(const TimeValue& value);
 
-// EXIF DateTime string -> UTC string (EXIF treated as UTC+8)
-std::string exifDateTimeToUTCString(const std::string& exifDateTime);
+// Filename stem on the value's own wall clock (see inTimeZone): "YYYYMMDD_HHMMSS", or
+// "YYYYMMDD_HHMMSS_mmm" with millisecond precision
+std::string formatTimeToLocalName(const TimeValue& value);
+// Same into buf (kNameStemMaxLength chars); returns the length written, 0 if value is empty
+size_t formatTimeToLocalName(const TimeValue& value, char* buf);
 
-// Format as UTC+8 for filename "YYYYMMDD_HHMMSS" or with ms "YYYYMMDD_HHMMSS_mmm"
-std::string formatTimeToUTC8Name(const std::string& timeStr);
+// EXIF value "YYYY:MM:DD HH:MM:SS" on the value's own wall clock into buf (kExifTimeLength chars);
+// returns the length written, 0 if value is empty
+size_t formatTimeForExif(const TimeValue& value, char* buf);
 
-// If timeStr is date-only (length <= 10), append current UTC time to avoid duplicate filenames
-std::string supplementDateWithCurrentUtcTime(const std::string& timeStr);
+// If value is date-only, give it the current UTC time of day to avoid duplicate filenames
+TimeValue supplementDateWithCurrentUtcTime(const TimeValue& value);
 
 }  // namespace filetimefixer
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "TimeParse.h"
+#include <cstddef>
+#include <cstring>
+
+// Fixed-layout time writers into caller buffers: no streams, no printf, no heap. Each returns the
+// number of chars written (no terminator). Fields must be in range (year 0..9999).
+
+namespace filetimefixer {
+
+namespace detail {
+
+inline constexpr char kDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+inline char* putDigits2(char* p, int value) {
+    std::memcpy(p, kDigitPairs + 2 * value, 2);
+    return p + 2;
+}
+
+inline char* putDigits3(char* p, int value) {
+    *p = static_cast<char>('0' + value / 100);
+    return putDigits2(p + 1, value % 100);
+}
+
+inline char* putDigits4(char* p, int value) {
+    return putDigits2(putDigits2(p, value / 100), value % 100);
+}
+
+// "YYYY<sep>MM<sep>DD<mid>HH:MM:SS"
+inline char* putDateTime(char* p, const FileNameTime& t, char dateSep, char mid) {
+    p = putDigits4(p, t.year);
+    *p++ = dateSep;
+    p = putDigits2(p, t.month);
+    *p++ = dateSep;
+    p = putDigits2(p, t.day);
+    *p++ = mid;
+    p = putDigits2(p, t.hour);
+    *p++ = ':';
+    p = putDigits2(p, t.minute);
+    *p++ = ':';
+    return putDigits2(p, t.second);
+}
+
+}  // namespace detail
+
+// Filename stem "YYYYMMDD_HHMMSS", or "YYYYMMDD_HHMMSS_mmm" if t.hasMillis
+constexpr size_t kNameStemMaxLength = 19;
+inline size_t formatNameStem(const FileNameTime& t, char* buf) {
+    char* p = detail::putDigits4(buf, t.year);
+    p = detail::putDigits2(p, t.month);
+    p = detail::putDigits2(p, t.day);
+    *p++ = '_';
+    p = detail::putDigits2(p, t.hour);
+    p = detail::putDigits2(p, t.minute);
+    p = detail::putDigits2(p, t.second);
+    if (t.hasMillis) {
+        *p++ = '_';
+        p = detail::putDigits3(p, t.millis);
+    }
+    return static_cast<size_t>(p - buf);
+}
+
+// EXIF DateTime value "YYYY:MM:DD HH:MM:SS"
+constexpr size_t kExifTimeLength = 19;
+inline size_t formatExifTime(const FileNameTime& t, char* buf) {
+    return static_cast<size_t>(detail::putDateTime(buf, t, ':', ' ') - buf);
+}
+
+// ISO form "YYYY-MM-DDTHH:MM:SS" (ffmpeg creation_time, logs)
+constexpr size_t kIsoTimeLength = 19;
+inline size_t formatIsoTime(const FileNameTime& t, char* buf) {
+    return static_cast<size_t>(detail::putDateTime(buf, t, '-', 'T') - buf);
+}
+
+}  // namespace filetimefixer
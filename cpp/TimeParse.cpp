@@ -1,129 +1,559 @@
 #include "TimeParse.h"
-#include <regex>
-#include <sstream>
-#include <iomanip>
-#ifdef _WIN32
-#include <time.h>
+#include "CivilTime.h"
+#include "TimeFormat.h"
+#include "TimeZone.h"
+#include "FileNamePatterns.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FTF_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FTF_TARGET(isa) __attribute__((target(isa)))
 #else
-#include <ctime>
+#define FTF_TARGET(isa)
 #endif
 
 namespace filetimefixer {
 
-bool isValidDate(const std::string& dateStr) {
-    if (dateStr.length() != 8) return false;
-    int year = std::stoi(dateStr.substr(0, 4));
-    int month = std::stoi(dateStr.substr(4, 2));
-    int day = std::stoi(dateStr.substr(6, 2));
-    if (month < 1 || month > 12) return false;
-    int daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-    if (month == 2 && (year % 400 == 0 || (year % 100 != 0 && year % 4 == 0)))
-        daysInMonth[1] = 29;
-    return day >= 1 && day <= daysInMonth[month - 1];
+namespace {
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
 }
 
-bool isValidTime(const std::string& timeStr) {
-    if (timeStr.length() != 6) return false;
-    int hour = std::stoi(timeStr.substr(0, 2));
-    int minute = std::stoi(timeStr.substr(2, 2));
-    int second = std::stoi(timeStr.substr(4, 2));
+// Word character as in regex \w
+inline bool isWordChar(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Value of n digits at p (caller has checked they are digits)
+inline int digitsValue(const char* p, int n) {
+    int v = 0;
+    for (int i = 0; i < n; ++i) v = v * 10 + (p[i] - '0');
+    return v;
+}
+
+bool allDigits(std::string_view s, size_t pos, size_t n) {
+    if (pos + n > s.size()) return false;
+    for (size_t i = pos; i < pos + n; ++i)
+        if (!isDigit(s[i])) return false;
+    return true;
+}
+
+bool validDate(int year, int month, int day) {
+    return isValidCivilDate(year, month, day);
+}
+
+bool validTime(int hour, int minute, int second) {
     return (hour >= 0 && hour < 24) && (minute >= 0 && minute < 60) && (second >= 0 && second < 60);
 }
 
-// UTC ms timestamp -> Beijing time (UTC+8), portable (no gmtime/locale)
-static void utcSecondsToYMDHMS(int64_t utcSeconds, int& y, int& mo, int& d, int& h, int& mi, int& s) {
-    const int64_t SEC_PER_DAY = 86400;
-    int64_t day = utcSeconds / SEC_PER_DAY;
-    int64_t secInDay = utcSeconds % SEC_PER_DAY;
-    if (secInDay < 0) { secInDay += SEC_PER_DAY; --day; }
-    h = static_cast<int>(secInDay / 3600);
-    mi = static_cast<int>((secInDay % 3600) / 60);
-    s = static_cast<int>(secInDay % 60);
-    for (y = 1970; ; ++y) {
-        int daysThisYear = (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)) ? 366 : 365;
-        if (day < daysThisYear) break;
-        day -= daysThisYear;
-    }
-    int daysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
-    if (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)) daysInMonth[1] = 29;
-    mo = 0;
-    while (mo < 12 && day >= daysInMonth[mo]) { day -= daysInMonth[mo]; ++mo; }
-    d = static_cast<int>(day) + 1;
-    mo += 1;
-}
-
-std::string timestampToBeijingTime(int64_t timestamp, bool isMilliseconds) {
+// YYYYMMDD at p
+bool readDate8(const char* p, FileNameTime& t) {
+    t.year = digitsValue(p, 4);
+    t.month = digitsValue(p + 4, 2);
+    t.day = digitsValue(p + 6, 2);
+    return validDate(t.year, t.month, t.day);
+}
+
+// HHMMSS at p
+bool readTime6(const char* p, FileNameTime& t) {
+    t.hour = digitsValue(p, 2);
+    t.minute = digitsValue(p + 2, 2);
+    t.second = digitsValue(p + 4, 2);
+    t.hasTime = true;
+    return validTime(t.hour, t.minute, t.second);
+}
+
+// YYYY<sep>MM<sep>DD<sep>HH<sep>MM<sep>SS starting at pos (pt... and Screenshot_... names)
+bool matchSeparatedLayout(std::string_view s, size_t pos, char sep) {
+    if (!allDigits(s, pos, 4)) return false;
+    pos += 4;
+    for (int field = 0; field < 5; ++field, pos += 3) {
+        if (pos >= s.size() || s[pos] != sep || !allDigits(s, pos + 1, 2)) return false;
+    }
+    return true;
+}
+
+bool readSeparatedLayout(const char* p, FileNameTime& t) {
+    t.year = digitsValue(p, 4);
+    t.month = digitsValue(p + 5, 2);
+    t.day = digitsValue(p + 8, 2);
+    t.hour = digitsValue(p + 11, 2);
+    t.minute = digitsValue(p + 14, 2);
+    t.second = digitsValue(p + 17, 2);
+    t.hasTime = true;
+    return validDate(t.year, t.month, t.day) && validTime(t.hour, t.minute, t.second);
+}
+
+// UTC timestamp (s or ms) -> wall-clock fields in the local zone (--tz, default UTC+8)
+FileNameTime timestampToLocalFields(int64_t timestamp, bool isMilliseconds) {
     if (!isMilliseconds) timestamp *= 1000;
     int64_t seconds = timestamp / 1000;
     int ms = static_cast<int>(timestamp % 1000);
     if (ms < 0) { ms += 1000; seconds -= 1; }
-    int64_t beijingSeconds = seconds + 8 * 3600;
-    int y, mo, d, h, mi, s;
-    utcSecondsToYMDHMS(beijingSeconds, y, mo, d, h, mi, s);
-    std::ostringstream ss;
-    ss << std::setfill('0')
-       << std::setw(4) << y << "-" << std::setw(2) << mo << "-" << std::setw(2) << d
-       << " " << std::setw(2) << h << ":" << std::setw(2) << mi << ":" << std::setw(2) << s
-       << "." << std::setw(3) << ms;
-    return ss.str();
+    CivilDateTime c = epochSecondsToCivil(seconds + localTimeZone().offsetSecondsAt(seconds));
+    FileNameTime t;
+    t.year = static_cast<int>(c.year);
+    t.month = c.month;
+    t.day = c.day;
+    t.hour = c.hour;
+    t.minute = c.minute;
+    t.second = c.second;
+    t.millis = ms;
+    t.hasTime = true;
+    t.hasMillis = true;
+    return t;
 }
 
-std::string parseFileNameTime(const std::string& filename) {
-    std::smatch match;
-
-    std::regex pattern1(R"((\d{8})[_-](\d{6}))");
-    if (std::regex_search(filename, match, pattern1) && isValidDate(match[1].str()) && isValidTime(match[2].str())) {
-        return match[1].str().substr(0, 4) + "-" + match[1].str().substr(4, 2) + "-" + match[1].str().substr(6, 2)
-            + " " + match[2].str().substr(0, 2) + ":" + match[2].str().substr(2, 2) + ":" + match[2].str().substr(4, 2);
-    }
-
-    // ptYYYY_MM_DD_HH_MM_SS (e.g. pt2021_10_23_21_52_39.jpg)
-    std::regex patternPt(R"(pt(\d{4})_(\d{2})_(\d{2})_(\d{2})_(\d{2})_(\d{2}))");
-    if (std::regex_search(filename, match, patternPt)) {
-        std::string yyyymmdd = match[1].str() + match[2].str() + match[3].str();
-        std::string hhmmss = match[4].str() + match[5].str() + match[6].str();
-        if (isValidDate(yyyymmdd) && isValidTime(hhmmss)) {
-            return match[1].str() + "-" + match[2].str() + "-" + match[3].str()
-                + " " + match[4].str() + ":" + match[5].str() + ":" + match[6].str();
+
+// Layout candidates of one name, fed its digit runs left to right. Only the leftmost candidate
+// of each layout is validated (later ones are not tried).
+class LayoutCandidates {
+public:
+    explicit LayoutCandidates(std::string_view s) : s_(s) {}
+
+    // Digit run [start, end). True when it completes a valid YYYYMMDD[_-]HHMMSS: that is the highest
+    // priority layout, so nothing later can win and out is final.
+    bool addRun(size_t start, size_t end, FileNameTime& out) {
+        static constexpr std::string_view kPt = "pt";
+        static constexpr std::string_view kScreenshot = "Screenshot_";
+        size_t runLength = end - start;
+        if (!dateTimeSeen_ && runLength >= 8 && end < s_.size() && (s_[end] == '_' || s_[end] == '-')
+            && allDigits(s_, end + 1, 6)) {
+            dateTimeSeen_ = true;
+            FileNameTime t;
+            if (readDate8(s_.data() + end - 8, t) && readTime6(s_.data() + end + 1, t)) {
+                out = t;
+                return true;
+            }
         }
+        if (ptLayout_ == npos && start >= kPt.size() && s_.substr(start - kPt.size(), kPt.size()) == kPt
+            && matchSeparatedLayout(s_, start, '_'))
+            ptLayout_ = start;
+        if (screenshot_ == npos && start >= kScreenshot.size()
+            && s_.substr(start - kScreenshot.size(), kScreenshot.size()) == kScreenshot
+            && matchSeparatedLayout(s_, start, '-'))
+            screenshot_ = start;
+        if (date8_ == npos && runLength >= 8) date8_ = start;
+        return false;
     }
 
-    // Screenshot_YYYY-MM-DD-HH-MM-SS[-...] (e.g. Screenshot_2021-03-25-01-12-43-235_com.tencent.mm.jpg)
-    std::regex patternScreenshot(R"(Screenshot_(\d{4})-(\d{2})-(\d{2})-(\d{2})-(\d{2})-(\d{2}))");
-    if (std::regex_search(filename, match, patternScreenshot)) {
-        std::string yyyymmdd = match[1].str() + match[2].str() + match[3].str();
-        std::string hhmmss = match[4].str() + match[5].str() + match[6].str();
-        if (isValidDate(yyyymmdd) && isValidTime(hhmmss)) {
-            return match[1].str() + "-" + match[2].str() + "-" + match[3].str()
-                + " " + match[4].str() + ":" + match[5].str() + ":" + match[6].str();
+    // Remaining layouts in priority order, once every run has been added
+    bool finish(FileNameTime& out, FileNameLayout& layout) const {
+        for (auto [pos, found] : { std::pair{ ptLayout_, FileNameLayout::Pt },
+                                   std::pair{ screenshot_, FileNameLayout::Screenshot } }) {
+            FileNameTime t;
+            if (pos != npos && readSeparatedLayout(s_.data() + pos, t)) {
+                out = t;
+                layout = found;
+                return true;
+            }
+        }
+        if (date8_ != npos && s_.substr(0, 8) != "mmexport") {
+            FileNameTime t;
+            if (readDate8(s_.data() + date8_, t)) {
+                out = t;
+                layout = FileNameLayout::Date8;
+                return true;
+            }
         }
+        // 13 or 10 digits right before the last '.', followed only by word chars
+        // (equivalent to the regex (\d{10}|\d{13})(?=\.\w+$))
+        size_t lastDot = s_.rfind('.');
+        if (lastDot == npos || lastDot + 1 >= s_.size()) return false;
+        for (size_t k = lastDot + 1; k < s_.size(); ++k)
+            if (!isWordChar(s_[k])) return false;
+        size_t runLength = 0;
+        while (runLength < lastDot && isDigit(s_[lastDot - runLength - 1])) ++runLength;
+        if (runLength < 10) return false;
+        size_t digits = runLength >= 13 ? 13 : 10;
+        int64_t ts = 0;
+        for (size_t k = lastDot - digits; k < lastDot; ++k) ts = ts * 10 + (s_[k] - '0');
+        out = timestampToLocalFields(ts, digits == 13);
+        layout = FileNameLayout::Timestamp;
+        return true;
+    }
+
+private:
+    static constexpr size_t npos = std::string_view::npos;
+    std::string_view s_;
+    bool dateTimeSeen_ = false;  // YYYYMMDD[_-]HHMMSS: checked as soon as found, wins if valid
+    size_t ptLayout_ = npos;     // YYYY of ptYYYY_MM_DD_HH_MM_SS
+    size_t screenshot_ = npos;   // YYYY of Screenshot_YYYY-MM-DD-HH-MM-SS
+    size_t date8_ = npos;        // First 8 consecutive digits
+};
+
+// Hit counts of findFileNameTime per layout, and the built-in layouts probed before the full scan
+// with --adaptive-layouts (one byte per layout, hottest first, 0xFF ends the list)
+std::atomic<uint64_t> g_layoutHits[kFileNameLayoutCount];
+std::atomic<uint64_t> g_probeHits{ 0 };
+std::atomic<uint64_t> g_lookups{ 0 };
+std::atomic<bool> g_adaptiveLayouts{ false };
+std::atomic<uint32_t> g_probeOrder{ 0xFFFFFFFFu };
+const uint64_t kReorderInterval = 1024;  // Lookups between re-rankings
+const size_t kMaxProbes = 2;             // A probe that misses costs a little, so only the hottest
+
+// No run of 4+ digits from pos on: no pt / Screenshot / 8-digit layout can start there
+bool noLongDigitRun(std::string_view s, size_t pos) {
+    size_t run = 0;
+    for (; pos < s.size(); ++pos) {
+        run = isDigit(s[pos]) ? run + 1 : 0;
+        if (run >= 4) return false;
     }
+    return true;
+}
 
-    std::regex pattern2(R"((\d{8}))");
-    if (filename.rfind("mmexport", 0) != 0 && std::regex_search(filename, match, pattern2) && isValidDate(match[1].str())) {
-        return match[1].str().substr(0, 4) + "-" + match[1].str().substr(4, 2) + "-" + match[1].str().substr(6, 2);
+// Try one layout on the first digit run [runStart, runEnd) of the name. It only answers when the
+// shape of the name rules out every layout of higher priority, so a hit is exactly what
+// scanFileNameTime returns; false means "not decided here" and the full scan runs.
+bool probeLayout(FileNameLayout layout, std::string_view s, size_t runStart, size_t runEnd, FileNameTime& out) {
+    FileNameTime t;
+    const size_t runLength = runEnd - runStart;
+    switch (layout) {
+    case FileNameLayout::DateTime:
+        // The first run is the leftmost 8+6 candidate, and 8+6 has the highest priority
+        if (runLength < 8 || runEnd >= s.size() || (s[runEnd] != '_' && s[runEnd] != '-')
+            || !allDigits(s, runEnd + 1, 6) || !readDate8(s.data() + runEnd - 8, t)
+            || !readTime6(s.data() + runEnd + 1, t))
+            return false;
+        break;
+    case FileNameLayout::Pt:
+    case FileNameLayout::Screenshot: {
+        // Separated fields are at most 4 digits long, so 8+6 cannot occur inside them
+        const std::string_view prefix = layout == FileNameLayout::Pt ? "pt" : "Screenshot_";
+        const size_t kSeparatedLength = 19;
+        if (runStart < prefix.size() || s.substr(runStart - prefix.size(), prefix.size()) != prefix
+            || !matchSeparatedLayout(s, runStart, layout == FileNameLayout::Pt ? '_' : '-')
+            || !noLongDigitRun(s, runStart + kSeparatedLength) || !readSeparatedLayout(s.data() + runStart, t))
+            return false;
+        break;
+    }
+    case FileNameLayout::Date8:
+        // A run of 8+ digits cannot start a separated layout, and nothing after it can start any layout
+        if (runLength < 8 || s.substr(0, 8) == "mmexport" || !noLongDigitRun(s, runEnd)
+            || !readDate8(s.data() + runStart, t))
+            return false;
+        break;
+    case FileNameLayout::Timestamp: {
+        // The only digit run ends at the extension; its first 8 digits must not be a date
+        const size_t lastDot = s.rfind('.');
+        if (lastDot != runEnd || runLength < 10 || lastDot + 1 >= s.size() || !noLongDigitRun(s, runEnd)
+            || (s.substr(0, 8) != "mmexport" && readDate8(s.data() + runStart, t)))
+            return false;
+        for (size_t k = lastDot + 1; k < s.size(); ++k)
+            if (!isWordChar(s[k])) return false;
+        const size_t digits = runLength >= 13 ? 13 : 10;
+        int64_t ts = 0;
+        for (size_t k = lastDot - digits; k < lastDot; ++k) ts = ts * 10 + (s[k] - '0');
+        t = timestampToLocalFields(ts, digits == 13);
+        break;
     }
+    default:
+        return false;
+    }
+    out = t;
+    return true;
+}
 
-    std::regex pattern3(R"((\d{10}|\d{13})(?=\.\w+$))");
-    if (std::regex_search(filename, match, pattern3)) {
-        int64_t ts = std::stoll(match[1].str());
-        bool isMs = (match[1].length() == 13);
-        std::string strTime = timestampToBeijingTime(ts, isMs);
-        std::string str(strTime);
-        str.erase(std::remove(str.begin(), str.end(), '-'), str.end());
-        if (str.length() >= 8 && isValidDate(str.substr(0, 8))) {
-            return strTime;
+bool probeHotLayouts(std::string_view s, FileNameTime& out, FileNameLayout& layout) {
+    uint32_t order = g_probeOrder.load(std::memory_order_relaxed);
+    if ((order & 0xFF) == 0xFF) return false;
+    size_t runStart = 0;
+    while (runStart < s.size() && !isDigit(s[runStart])) ++runStart;
+    size_t runEnd = runStart;
+    while (runEnd < s.size() && isDigit(s[runEnd])) ++runEnd;
+    if (runStart == runEnd) return false;
+    for (; (order & 0xFF) != 0xFF; order >>= 8) {
+        FileNameLayout candidate = static_cast<FileNameLayout>(order & 0xFF);
+        if (probeLayout(candidate, s, runStart, runEnd, out)) {
+            layout = candidate;
+            g_probeHits.fetch_add(1, std::memory_order_relaxed);
+            return true;
         }
-        if (strTime.rfind('.') != std::string::npos && strTime.rfind('.') >= 13 && filename.rfind("mmexport", 0) == 0) {
-            size_t dot = strTime.rfind('.');
-            std::string sub = strTime.substr(dot - 13, 13);
-            if (sub.length() == 13) {
-                int64_t subTs = std::stoll(sub);
-                return timestampToBeijingTime(subTs, isMs);
-            }
+    }
+    return false;
+}
+
+// Rank the built-in layouts by hits so far; those with at least 1/8 of the hits are probed
+void reorderProbes() {
+    std::pair<uint64_t, FileNameLayout> ranked[] = {
+        { 0, FileNameLayout::DateTime }, { 0, FileNameLayout::Pt }, { 0, FileNameLayout::Screenshot },
+        { 0, FileNameLayout::Date8 }, { 0, FileNameLayout::Timestamp },
+    };
+    uint64_t total = 0;
+    for (auto& [hits, layout] : ranked) {
+        hits = g_layoutHits[static_cast<size_t>(layout)].load(std::memory_order_relaxed);
+        total += hits;
+    }
+    std::stable_sort(std::begin(ranked), std::end(ranked), [](const auto& a, const auto& b) { return a.first > b.first; });
+    uint32_t order = 0xFFFFFFFFu;
+    for (size_t i = 0; i < kMaxProbes; ++i) {
+        if (ranked[i].first == 0 || ranked[i].first * 8 < total) break;
+        order = (order & ~(0xFFu << (8 * i))) | (static_cast<uint32_t>(ranked[i].second) << (8 * i));
+    }
+    g_probeOrder.store(order, std::memory_order_relaxed);
+}
+
+// Batch scan with SIMD: names up to kMaskBytes are copied into a zero-padded block and turned into
+// a bitmask of digit positions, one bit per byte (without SIMD a byte loop is no faster than the
+// plain scan, so the scalar path is scanFileNameTime itself)
+const size_t kMaskBytes = 64;
+
+#ifdef FTF_X86_SIMD
+FTF_TARGET("sse4.2") uint64_t digitMaskSse42(const char* block) {
+    const __m128i range = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kMaskBytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i m = _mm_cmpestrm(range, 2, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK);
+        mask |= uint64_t{ static_cast<uint16_t>(_mm_cvtsi128_si32(m)) } << i;
+    }
+    return mask;
+}
+
+FTF_TARGET("avx2") uint64_t digitMaskAvx2(const char* block) {
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8('9');
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kMaskBytes; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        __m256i digit = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, zero), v),
+                                         _mm256_cmpeq_epi8(_mm256_min_epu8(v, nine), v));
+        mask |= uint64_t{ static_cast<uint32_t>(_mm256_movemask_epi8(digit)) } << i;
+    }
+    return mask;
+}
+#endif
+
+struct DigitMaskIsa {
+    const char* name;
+    uint64_t (*mask)(const char*);  // nullptr: plain scanFileNameTime
+    bool supported;
+};
+
+// Preferred first; scalar is last and always supported
+std::span<const DigitMaskIsa> digitMaskIsas() {
+#if defined(FTF_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();  // May run from a static initializer
+#endif
+    static const DigitMaskIsa isas[] = {
+#ifdef FTF_X86_SIMD
+#if defined(_MSC_VER) && !defined(__clang__)
+        // Leaf 1 ECX: SSE4.2 bit 20, OSXSAVE 27, AVX 28; leaf 7 EBX: AVX2 bit 5 (needs OS YMM state)
+        { "avx2", digitMaskAvx2, [] {
+              int r[4];
+              __cpuid(r, 0);
+              if (r[0] < 7) return false;
+              __cpuid(r, 1);
+              if (!(r[2] & (1 << 27)) || !(r[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6) return false;
+              __cpuidex(r, 7, 0);
+              return (r[1] & (1 << 5)) != 0;
+          }() },
+        { "sse4.2", digitMaskSse42, [] {
+              int r[4];
+              __cpuid(r, 1);
+              return (r[2] & (1 << 20)) != 0;
+          }() },
+#else
+        { "avx2", digitMaskAvx2, __builtin_cpu_supports("avx2") != 0 },
+        { "sse4.2", digitMaskSse42, __builtin_cpu_supports("sse4.2") != 0 },
+#endif
+#endif
+        { "scalar", nullptr, true },
+    };
+    return isas;
+}
+
+const DigitMaskIsa* bestDigitMaskIsa() {
+    for (const DigitMaskIsa& isa : digitMaskIsas())
+        if (isa.supported) return &isa;
+    return nullptr;
+}
+
+const DigitMaskIsa* g_batchIsa = bestDigitMaskIsa();
+
+// Positions where a layout scanFileNameTime knows could start: 8 consecutive digits, or the
+// YYYY?MM?DD?HH?MM?SS digit shape of the pt / Screenshot layouts
+uint64_t candidateStarts(uint64_t digits) {
+    uint64_t run8 = digits;
+    for (int k = 1; k < 8; ++k) run8 &= digits >> k;
+    uint64_t separated = digits & (digits >> 1) & (digits >> 2) & (digits >> 3);
+    for (int k = 5; k < 19; k += 3) separated &= (digits >> k) & (digits >> (k + 1));
+    return run8 | separated;
+}
+
+}  // namespace
+
+size_t parseFileNameTimes(std::span<const std::string_view> names, std::span<FileNameTime> times) {
+    uint64_t (*digitMask)(const char*) = g_batchIsa->mask;
+    alignas(32) char block[kMaskBytes];
+    size_t found = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::string_view name = names[i];
+        FileNameTime& t = times[i];
+        t = FileNameTime{};
+        if (!digitMask || name.size() > kMaskBytes) {
+            if (scanFileNameTime(name, t)) ++found;
+            continue;
+        }
+        std::memset(block, 0, kMaskBytes);
+        std::memcpy(block, name.data(), name.size());
+        uint64_t digits = digitMask(block);
+        if (candidateStarts(digits) == 0) continue;
+        // Walk the digit runs straight from the mask
+        LayoutCandidates candidates(name);
+        bool done = false;
+        while (digits != 0 && !done) {
+            int start = std::countr_zero(digits);
+            int length = std::countr_one(digits >> start);
+            done = candidates.addRun(static_cast<size_t>(start), static_cast<size_t>(start + length), t);
+            digits &= length + start >= 64 ? 0 : ~uint64_t{ 0 } << (start + length);
         }
+        FileNameLayout layout;
+        if (done || candidates.finish(t, layout)) ++found;
+    }
+    return found;
+}
+
+const char* fileNameBatchIsa() {
+    return g_batchIsa->name;
+}
+
+bool selectFileNameBatchIsa(std::string_view isa) {
+    for (const DigitMaskIsa& entry : digitMaskIsas()) {
+        if (entry.name != isa) continue;
+        if (entry.supported) g_batchIsa = &entry;
+        return entry.supported;
+    }
+    return false;
+}
+
+bool isValidFileNameTime(const FileNameTime& t) {
+    return validDate(t.year, t.month, t.day) && (!t.hasTime || validTime(t.hour, t.minute, t.second));
+}
+
+bool isValidDate(const std::string& dateStr) {
+    if (dateStr.length() != 8 || !allDigits(dateStr, 0, 8)) return false;
+    FileNameTime t;
+    return readDate8(dateStr.data(), t);
+}
+
+bool isValidTime(const std::string& timeStr) {
+    if (timeStr.length() != 6 || !allDigits(timeStr, 0, 6)) return false;
+    FileNameTime t;
+    return readTime6(timeStr.data(), t);
+}
+
+std::string timestampToLocalTime(int64_t timestamp, bool isMilliseconds) {
+    char buf[kFileNameTimeMaxLength];
+    size_t n = formatFileNameTime(timestampToLocalFields(timestamp, isMilliseconds), buf);
+    return std::string(buf, n);
+}
+
+size_t formatFileNameTime(const FileNameTime& t, char* buf) {
+    if (!t.hasTime) {
+        char* p = detail::putDigits4(buf, t.year);
+        *p++ = '-';
+        p = detail::putDigits2(p, t.month);
+        *p++ = '-';
+        return static_cast<size_t>(detail::putDigits2(p, t.day) - buf);
+    }
+    char* p = detail::putDateTime(buf, t, '-', ' ');
+    if (t.hasMillis) {
+        *p++ = '.';
+        p = detail::putDigits3(p, t.millis);
+    }
+    return static_cast<size_t>(p - buf);
+}
+
+bool scanFileNameTime(std::string_view s, FileNameTime& out, FileNameLayout& layout) {
+    LayoutCandidates candidates(s);
+    layout = FileNameLayout::NotFound;
+    for (size_t i = 0; i < s.size();) {
+        if (!isDigit(s[i])) {
+            ++i;
+            continue;
+        }
+        size_t start = i;
+        while (i < s.size() && isDigit(s[i])) ++i;
+        if (candidates.addRun(start, i, out)) {
+            layout = FileNameLayout::DateTime;
+            return true;
+        }
+    }
+    return candidates.finish(out, layout);
+}
+
+bool scanFileNameTime(std::string_view s, FileNameTime& out) {
+    FileNameLayout layout;
+    return scanFileNameTime(s, out, layout);
+}
+
+bool findFileNameTime(std::string_view filename, FileNameTime& out, std::string& patternName) {
+    int pattern = -1;
+    const FileNamePatternSet* user = userFileNamePatterns();
+    FileNameLayout layout = FileNameLayout::UserPattern;
+    bool found = true;
+    if (user && user->match(filename, out, pattern)) {
+        patternName = user->patternName(pattern);
+    } else {
+        patternName.clear();
+        bool adaptive = g_adaptiveLayouts.load(std::memory_order_relaxed);
+        found = (adaptive && probeHotLayouts(filename, out, layout)) || scanFileNameTime(filename, out, layout);
+        if (adaptive && g_lookups.fetch_add(1, std::memory_order_relaxed) % kReorderInterval == kReorderInterval - 1)
+            reorderProbes();
+    }
+    g_layoutHits[static_cast<size_t>(layout)].fetch_add(1, std::memory_order_relaxed);
+    return found;
+}
+
+const char* fileNameLayoutName(FileNameLayout layout) {
+    switch (layout) {
+    case FileNameLayout::DateTime: return "YYYYMMDD_HHMMSS";
+    case FileNameLayout::Pt: return "ptYYYY_MM_DD";
+    case FileNameLayout::Screenshot: return "Screenshot_";
+    case FileNameLayout::Date8: return "YYYYMMDD";
+    case FileNameLayout::Timestamp: return "timestamp";
+    case FileNameLayout::UserPattern: return "--patterns";
+    case FileNameLayout::NotFound: return "no time";
     }
     return "";
 }
 
+FileNameLayoutStats fileNameLayoutStats() {
+    FileNameLayoutStats stats;
+    for (size_t i = 0; i < kFileNameLayoutCount; ++i) stats.hits[i] = g_layoutHits[i].load(std::memory_order_relaxed);
+    stats.probeHits = g_probeHits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void resetFileNameLayoutStats() {
+    for (auto& hits : g_layoutHits) hits.store(0, std::memory_order_relaxed);
+    g_probeHits.store(0, std::memory_order_relaxed);
+    g_lookups.store(0, std::memory_order_relaxed);
+    g_probeOrder.store(0xFFFFFFFFu, std::memory_order_relaxed);
+}
+
+void setAdaptiveFileNameLayouts(bool enabled) {
+    g_adaptiveLayouts.store(enabled, std::memory_order_relaxed);
+}
+
+std::string parseFileNameTime(const std::string& filename) {
+    FileNameTime t;
+    std::string patternName;
+    if (!findFileNameTime(filename, t, patternName)) return "";
+    char buf[kFileNameTimeMaxLength];
+    return std::string(buf, formatFileNameTime(t, buf));
+}
+
 }  // namespace filetimefixer
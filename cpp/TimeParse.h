@@ -1,9 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 
 namespace filetimefixer {
 
+// Broken-down wall-clock time; found in a filename it is name time, in the local zone (--tz, default UTC+8).
+struct FileNameTime {
+    int year = 0, month = 0, day = 0;
+    int hour = 0, minute = 0, second = 0, millis = 0;
+    bool hasTime = false;    // false: date only ("YYYY-MM-DD")
+    bool hasMillis = false;  // From a 10/13-digit timestamp or {ms3}: formatted with ".mmm"
+};
+
+// Date is a real calendar day and, if hasTime, the time of day is in range
+bool isValidFileNameTime(const FileNameTime& t);
+
 // Parsed time string from filename ("YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DD")
 // Validate 8-digit date YYYYMMDD
 bool isValidDate(const std::string& dateStr);
@@ -11,11 +26,60 @@ bool isValidDate(const std::string& dateStr);
 // Validate 6-digit time HHMMSS
 bool isValidTime(const std::string& timeStr);
 
-// Timestamp to Beijing-time string (seconds or milliseconds)
-std::string timestampToBeijingTime(int64_t timestamp, bool isMilliseconds);
+// Timestamp (seconds or milliseconds) to a local-zone time string
+std::string timestampToLocalTime(int64_t timestamp, bool isMilliseconds);
+
+// Single pass over the name, no regex and no heap allocation. Layouts in priority order (the
+// first occurrence of each layout is the only one considered, as test_spec/time_parse.yaml expects):
+// YYYYMMDD[_-]HHMMSS, ptYYYY_MM_DD_HH_MM_SS, Screenshot_YYYY-MM-DD-HH-MM-SS, YYYYMMDD (not for
+// mmexport names), and a 13- or 10-digit UTC timestamp right before the extension.
+bool scanFileNameTime(std::string_view filename, FileNameTime& out);
+
+// Which layout produced a name time (hit statistics; NotFound when there was none)
+enum class FileNameLayout : uint8_t { DateTime, Pt, Screenshot, Date8, Timestamp, UserPattern, NotFound };
+constexpr size_t kFileNameLayoutCount = 7;
+const char* fileNameLayoutName(FileNameLayout layout);
+
+// Same, also reporting the layout that matched
+bool scanFileNameTime(std::string_view filename, FileNameTime& out, FileNameLayout& layout);
+
+// Batch form of scanFileNameTime for bulk parsing (index rebuilds, plan generation): times[i] gets
+// the result for names[i], or a default FileNameTime (year 0) if nothing is found; returns the
+// number found. Each name's digit mask is built with AVX2 or SSE4.2 when the CPU has them (chosen
+// at runtime, scalar otherwise); names with neither an 8-digit run nor the 4-2-2-2-2-2 shape of the
+// separated layouts are rejected from the mask alone, the rest go through scanFileNameTime.
+// times must be at least as long as names. User patterns (--patterns) are not consulted.
+size_t parseFileNameTimes(std::span<const std::string_view> names, std::span<FileNameTime> times);
 
-// Parse time from filename: 8+6, 8-digit date, 10/13-digit timestamp, mmexport, etc.
-// Returns empty string on failure (may print to stderr)
+// Instruction set parseFileNameTimes uses: "avx2", "sse4.2" or "scalar"
+const char* fileNameBatchIsa();
+// Tests: switch parseFileNameTimes to the named instruction set; false if the CPU or build lacks it
+bool selectFileNameBatchIsa(std::string_view isa);
+
+// Write t as "YYYY-MM-DD", "YYYY-MM-DD HH:MM:SS" or "YYYY-MM-DD HH:MM:SS.mmm" (no terminator).
+// buf must hold kFileNameTimeMaxLength chars; returns the length written.
+constexpr size_t kFileNameTimeMaxLength = 23;
+size_t formatFileNameTime(const FileNameTime& t, char* buf);
+
+// Parse time from filename: user patterns (--patterns) first, then the built-in layouts
+// (8+6, 8-digit date, 10/13-digit timestamp, mmexport, etc.). Returns empty string on failure
 std::string parseFileNameTime(const std::string& filename);
 
+// Same as fields (name time, local zone); patternName receives the name of the user pattern that
+// matched ("" for a built-in layout)
+bool findFileNameTime(std::string_view filename, FileNameTime& out, std::string& patternName);
+
+// Hits of findFileNameTime per FileNameLayout since the start (or the last reset)
+struct FileNameLayoutStats {
+    uint64_t hits[kFileNameLayoutCount] = {};
+    uint64_t probeHits = 0;  // Answered by a hot-layout probe (--adaptive-layouts) without the full scan
+};
+FileNameLayoutStats fileNameLayoutStats();
+void resetFileNameLayoutStats();
+
+// --adaptive-layouts: findFileNameTime first tries the built-in layouts that hit most often so far
+// (re-ranked every 1024 lookups), each anchored at the first digit run and accepted only when the
+// rest of the name rules out every higher-priority layout. Results are the same as the full scan.
+void setAdaptiveFileNameLayouts(bool enabled);
+
 }  // namespace filetimefixer
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace filetimefixer {
+
+enum class TimePrecision : uint8_t {
+    None,          // No time (nothing found)
+    Date,          // Date only: epochMs is midnight of that day in the source zone
+    Seconds,
+    Milliseconds,  // From a 13-digit timestamp or a {ms3} pattern field
+};
+
+// Default zone of filename and EXIF wall-clock times (--tz replaces it)
+constexpr int kBeijingOffsetMinutes = 8 * 60;
+
+// A point in time as it travels from read through resolve to the writes; strings are made from it
+// only for output.
+struct TimeValue {
+    int64_t epochMs = 0;  // UTC milliseconds since 1970-01-01
+    TimePrecision precision = TimePrecision::None;
+    int16_t offsetMinutes = 0;  // UTC offset of the wall clock it is read / written in (video creation_time: 0)
+
+    bool empty() const { return precision == TimePrecision::None; }
+    bool hasTimeOfDay() const { return precision >= TimePrecision::Seconds; }
+    /// Whole UTC seconds (rounded down, also before 1970)
+    int64_t epochSeconds() const { return epochMs >= 0 ? epochMs / 1000 : -((-epochMs + 999) / 1000); }
+};
+
+}  // namespace filetimefixer
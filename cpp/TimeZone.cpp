@@ -0,0 +1,340 @@
+#include "TimeZone.h"
+#include "CivilTime.h"
+#include "TimeValue.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace filetimefixer {
+
+namespace {
+
+const size_t kMaxTzifSize = 1 << 20;
+
+std::shared_ptr<const TimeZone> g_localZone;
+
+uint32_t readBigEndian32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+int64_t readBigEndian64(const unsigned char* p) {
+    return static_cast<int64_t>((uint64_t(readBigEndian32(p)) << 32) | readBigEndian32(p + 4));
+}
+
+// Cursor over a POSIX TZ string ("EST5EDT,M3.2.0,M11.1.0", "<+0530>-5:30", ...)
+class PosixRuleReader {
+public:
+    explicit PosixRuleReader(std::string_view text) : s_(text) {}
+
+    bool done() const { return i_ >= s_.size(); }
+    bool accept(char c) {
+        if (i_ < s_.size() && s_[i_] == c) {
+            ++i_;
+            return true;
+        }
+        return false;
+    }
+
+    // Zone abbreviation: 3+ letters or <...>
+    bool name() {
+        if (accept('<')) {
+            size_t close = s_.find('>', i_);
+            if (close == std::string_view::npos) return false;
+            i_ = close + 1;
+            return true;
+        }
+        size_t start = i_;
+        while (i_ < s_.size() && ((s_[i_] >= 'A' && s_[i_] <= 'Z') || (s_[i_] >= 'a' && s_[i_] <= 'z'))) ++i_;
+        return i_ - start >= 3;
+    }
+
+    // [+-]hh[:mm[:ss]] in seconds; hours up to 167 (rule times may exceed a day)
+    bool duration(int32_t& seconds) {
+        bool negative = false;
+        if (accept('-')) negative = true;
+        else accept('+');
+        int hours = 0;
+        if (!number(0, 167, hours)) return false;
+        int minutes = 0, secs = 0;
+        if (accept(':')) {
+            if (!number(0, 59, minutes)) return false;
+            if (accept(':') && !number(0, 59, secs)) return false;
+        }
+        seconds = (hours * 3600 + minutes * 60 + secs) * (negative ? -1 : 1);
+        return true;
+    }
+
+    bool number(int low, int high, int& value) {
+        size_t start = i_;
+        value = 0;
+        while (i_ < s_.size() && s_[i_] >= '0' && s_[i_] <= '9' && i_ - start < 4) value = value * 10 + (s_[i_++] - '0');
+        return i_ > start && value >= low && value <= high;
+    }
+
+private:
+    std::string_view s_;
+    size_t i_ = 0;
+};
+
+// One end of the DST period: Jn (1..365, Feb 29 never counted), n (0..365) or Mm.w.d
+struct PosixDate {
+    char kind = 'M';
+    int month = 0, week = 0, weekday = 0, day = 0;
+    int32_t time = 2 * 3600;  // Local time of the change
+
+    bool read(PosixRuleReader& in) {
+        if (in.accept('M')) {
+            kind = 'M';
+            if (!in.number(1, 12, month) || !in.accept('.') || !in.number(1, 5, week) || !in.accept('.')
+                || !in.number(0, 6, weekday))
+                return false;
+        } else if (in.accept('J')) {
+            kind = 'J';
+            if (!in.number(1, 365, day)) return false;
+        } else {
+            kind = 'n';
+            if (!in.number(0, 365, day)) return false;
+        }
+        return !in.accept('/') || in.duration(time);
+    }
+
+    // Days since the epoch of this date in year
+    int64_t dayIn(int64_t year) const {
+        const int64_t january1 = daysFromCivil(year, 1, 1);
+        if (kind == 'J') return january1 + day - 1 + (isLeapYear(year) && day >= 60 ? 1 : 0);
+        if (kind == 'n') return january1 + day;
+        const int64_t first = daysFromCivil(year, month, 1);
+        const int64_t firstWeekday = ((first + 4) % 7 + 7) % 7;  // 1970-01-01 was a Thursday
+        int64_t d = first + (weekday - firstWeekday + 7) % 7 + (week - 1) * 7;
+        while (d >= first + daysInMonth(year, month)) d -= 7;
+        return d;
+    }
+};
+
+std::string fixedZoneName(int offsetMinutes) {
+    int minutes = offsetMinutes < 0 ? -offsetMinutes : offsetMinutes;
+    std::string name = "UTC";
+    name += offsetMinutes < 0 ? '-' : '+';
+    name += static_cast<char>('0' + minutes / 600 % 10);
+    name += static_cast<char>('0' + minutes / 60 % 10);
+    name += ':';
+    name += static_cast<char>('0' + minutes % 60 / 10);
+    name += static_cast<char>('0' + minutes % 10);
+    return name;
+}
+
+}  // namespace
+
+TimeZone TimeZone::fixed(int offsetMinutes) {
+    TimeZone zone;
+    zone.name_ = fixedZoneName(offsetMinutes);
+    zone.initialOffset_ = offsetMinutes * 60;
+    return zone;
+}
+
+bool TimeZone::load(const std::string& name, TimeZone& out, std::string& error) {
+    int offsetMinutes = 0;
+    if (parseUtcOffset(name, offsetMinutes)) {
+        out = fixed(offsetMinutes);
+        return true;
+    }
+    std::string path = name;
+    bool isPath = !name.empty() && (name[0] == '/' || name[0] == '.' || name.find('\\') != std::string::npos
+                                    || (name.size() > 1 && name[1] == ':'));
+    if (!isPath) {
+        if (name.empty() || name.find("..") != std::string::npos) {
+            error = "invalid time zone name: " + name;
+            return false;
+        }
+        const char* dir = std::getenv("TZDIR");
+        path = std::string(dir && *dir ? dir : "/usr/share/zoneinfo") + "/" + name;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        if (name == "UTC") {
+            out = fixed(0);
+            out.name_ = "UTC";
+            return true;
+        }
+        error = "unknown time zone " + name + " (no " + path + "; set TZDIR to a zoneinfo directory)";
+        return false;
+    }
+    std::string data;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() > kMaxTzifSize) {
+        error = path + ": not a TZif file";
+        return false;
+    }
+    TimeZone zone;
+    zone.name_ = name;
+    if (!zone.readTzif(data, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    out = std::move(zone);
+    return true;
+}
+
+// RFC 8536: header, v1 data (32-bit times), then for version 2+ a second header, the same data with
+// 64-bit times, and a "\n<POSIX TZ>\n" footer. Leap-second records are skipped.
+bool TimeZone::readTzif(std::string_view data, std::string& error) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t kHeaderSize = 44;
+    auto blockSize = [](const unsigned char* header, size_t timeSize) {
+        uint32_t isUtCount = readBigEndian32(header + 20), isStdCount = readBigEndian32(header + 24);
+        uint32_t leapCount = readBigEndian32(header + 28), timeCount = readBigEndian32(header + 32);
+        uint32_t typeCount = readBigEndian32(header + 36), charCount = readBigEndian32(header + 40);
+        return uint64_t(timeCount) * (timeSize + 1) + uint64_t(typeCount) * 6 + charCount
+            + uint64_t(leapCount) * (timeSize + 4) + isStdCount + isUtCount;
+    };
+    if (data.size() < kHeaderSize || data.compare(0, 4, "TZif") != 0) {
+        error = "not a TZif file";
+        return false;
+    }
+    size_t header = 0;
+    size_t timeSize = 4;
+    if (p[4] >= '2') {
+        uint64_t v1 = blockSize(p, 4);
+        if (kHeaderSize + v1 + kHeaderSize > data.size() || data.compare(kHeaderSize + v1, 4, "TZif") != 0) {
+            error = "truncated TZif file";
+            return false;
+        }
+        header = kHeaderSize + static_cast<size_t>(v1);
+        timeSize = 8;
+    }
+    const unsigned char* h = p + header;
+    const uint32_t timeCount = readBigEndian32(h + 32), typeCount = readBigEndian32(h + 36);
+    const uint64_t size = blockSize(h, timeSize);
+    if (typeCount == 0 || header + kHeaderSize + size > data.size()) {
+        error = "truncated TZif file";
+        return false;
+    }
+    const unsigned char* times = h + kHeaderSize;
+    const unsigned char* indices = times + size_t(timeCount) * timeSize;
+    const unsigned char* types = indices + timeCount;
+    auto typeOffset = [types](size_t type) { return static_cast<int32_t>(readBigEndian32(types + type * 6)); };
+
+    initialOffset_ = typeOffset(0);
+    transitions_.clear();
+    int64_t previous = INT64_MIN;
+    for (uint32_t i = 0; i < timeCount; ++i) {
+        int64_t at = timeSize == 8 ? readBigEndian64(times + size_t(i) * 8)
+                                   : static_cast<int32_t>(readBigEndian32(times + size_t(i) * 4));
+        if (indices[i] >= typeCount || (i > 0 && at <= previous)) {
+            error = "bad transition table";
+            return false;
+        }
+        addTransition(at, typeOffset(indices[i]));
+        previous = at;
+    }
+
+    if (timeSize == 8) {
+        size_t footer = header + kHeaderSize + static_cast<size_t>(size);
+        if (footer < data.size() && data[footer] == '\n') {
+            size_t end = data.find('\n', footer + 1);
+            if (end != std::string_view::npos && end > footer + 1)
+                return expandPosixRule(data.substr(footer + 1, end - footer - 1), error);
+        }
+    }
+    return true;
+}
+
+bool TimeZone::expandPosixRule(std::string_view rule, std::string& error) {
+    PosixRuleReader in(rule);
+    int32_t stdOffset = 0;
+    if (!in.name() || !in.duration(stdOffset)) {
+        error = "bad TZ rule " + std::string(rule);
+        return false;
+    }
+    stdOffset = -stdOffset;  // POSIX offsets are west of UTC
+    if (in.done()) {
+        if (transitions_.empty()) initialOffset_ = stdOffset;
+        return true;
+    }
+    int32_t dstOffset = stdOffset + 3600;
+    PosixDate start, end;
+    if (!in.name()) {
+        error = "bad TZ rule " + std::string(rule);
+        return false;
+    }
+    if (!in.accept(',')) {
+        int32_t west = 0;
+        if (in.done()) return true;  // DST named without rules: keep the table as it is
+        if (!in.duration(west) || !in.accept(',')) {
+            error = "bad TZ rule " + std::string(rule);
+            return false;
+        }
+        dstOffset = -west;
+    }
+    if (!start.read(in) || !in.accept(',') || !end.read(in) || !in.done()) {
+        error = "bad TZ rule " + std::string(rule);
+        return false;
+    }
+
+    const int64_t after = transitions_.empty() ? INT64_MIN : transitions_.back().utcSeconds;
+    int64_t firstYear = transitions_.empty() ? 1970 : epochSecondsToCivil(after).year;
+    for (int64_t year = firstYear; year <= kLastExpandedYear; ++year) {
+        Transition changes[2] = {
+            { start.dayIn(year) * kSecondsPerDay + start.time - stdOffset, dstOffset },
+            { end.dayIn(year) * kSecondsPerDay + end.time - dstOffset, stdOffset },
+        };
+        if (changes[1].utcSeconds < changes[0].utcSeconds) std::swap(changes[0], changes[1]);
+        for (const Transition& t : changes)
+            if (t.utcSeconds > after) addTransition(t.utcSeconds, t.offsetSeconds);
+    }
+    return true;
+}
+
+void TimeZone::addTransition(int64_t utcSeconds, int32_t offsetSeconds) {
+    int32_t current = transitions_.empty() ? initialOffset_ : transitions_.back().offsetSeconds;
+    if (offsetSeconds != current) transitions_.push_back({ utcSeconds, offsetSeconds });
+}
+
+int TimeZone::offsetSecondsAt(int64_t utcSeconds) const {
+    auto it = std::upper_bound(transitions_.begin(), transitions_.end(), utcSeconds,
+                               [](int64_t t, const Transition& tr) { return t < tr.utcSeconds; });
+    return it == transitions_.begin() ? initialOffset_ : std::prev(it)->offsetSeconds;
+}
+
+int64_t TimeZone::toUtc(int64_t localSeconds) const {
+    // Offsets before and after any transition near this wall time (transitions are days apart)
+    const int32_t before = offsetSecondsAt(localSeconds - kSecondsPerDay);
+    const int32_t after = offsetSecondsAt(localSeconds + kSecondsPerDay);
+    int64_t best = INT64_MAX;
+    for (int32_t offset : { before, after }) {
+        int64_t utc = localSeconds - offset;
+        if (offsetSecondsAt(utc) == offset) best = std::min(best, utc);
+    }
+    return best != INT64_MAX ? best : localSeconds - before;  // In a gap
+}
+
+bool parseUtcOffset(std::string_view text, int& offsetMinutes) {
+    if (text.size() < 3 || (text[0] != '+' && text[0] != '-')) return false;
+    auto digit = [&text](size_t i) { return i < text.size() && text[i] >= '0' && text[i] <= '9'; };
+    if (!digit(1) || !digit(2)) return false;
+    int hours = (text[1] - '0') * 10 + (text[2] - '0');
+    int minutes = 0;
+    size_t i = 3;
+    if (i < text.size() && text[i] == ':') ++i;
+    if (i < text.size()) {
+        if (!digit(i) || !digit(i + 1) || i + 2 != text.size()) return false;
+        minutes = (text[i] - '0') * 10 + (text[i + 1] - '0');
+    } else if (i != 3) {
+        return false;
+    }
+    if (hours > 14 || minutes > 59) return false;
+    offsetMinutes = (hours * 60 + minutes) * (text[0] == '-' ? -1 : 1);
+    return true;
+}
+
+void setLocalTimeZone(std::shared_ptr<const TimeZone> zone) {
+    g_localZone = std::move(zone);
+}
+
+const TimeZone& localTimeZone() {
+    static const TimeZone beijing = TimeZone::fixed(kBeijingOffsetMinutes);
+    return g_localZone ? *g_localZone : beijing;
+}
+
+}  // namespace filetimefixer
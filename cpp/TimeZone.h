@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace filetimefixer {
+
+// UTC offset rules of one zone as a sorted table of transitions, looked up by binary search. Built
+// once (from a TZif file or a fixed offset) and read-only afterwards, so it is shared by all
+// workers without locks; no tzset, TZ variable or libc zone call is involved.
+class TimeZone {
+public:
+    /// Constant offset, e.g. UTC+8 or an EXIF OffsetTimeOriginal
+    static TimeZone fixed(int offsetMinutes);
+
+    /// name is an IANA zone ("Asia/Shanghai", read from $TZDIR or /usr/share/zoneinfo), a path to
+    /// a TZif file, "UTC", or a fixed offset "+HH:MM" / "-HH:MM". Transitions after the last one in
+    /// the file are expanded from its POSIX TZ footer up to kLastExpandedYear.
+    static bool load(const std::string& name, TimeZone& out, std::string& error);
+
+    static constexpr int kLastExpandedYear = 2100;
+
+    /// Offset from UTC (seconds) in effect at the given UTC time
+    int offsetSecondsAt(int64_t utcSeconds) const;
+    /// UTC time of a wall-clock time in this zone. In a DST gap the time is read with the offset
+    /// before the gap; in an overlap the earlier of the two instants is used.
+    int64_t toUtc(int64_t localSeconds) const;
+
+    const std::string& name() const { return name_; }
+    size_t transitionCount() const { return transitions_.size(); }
+
+private:
+    struct Transition {
+        int64_t utcSeconds;  // First second the offset applies
+        int32_t offsetSeconds;
+    };
+
+    bool readTzif(std::string_view data, std::string& error);
+    bool expandPosixRule(std::string_view rule, std::string& error);
+    void addTransition(int64_t utcSeconds, int32_t offsetSeconds);
+
+    std::string name_;
+    int32_t initialOffset_ = 0;  // Before the first transition (or always, for a fixed zone)
+    std::vector<Transition> transitions_;
+};
+
+/// Parse "+HH:MM", "-HH:MM", "+HHMM" or "+HH" (EXIF OffsetTime*, --tz) into minutes east of UTC
+bool parseUtcOffset(std::string_view text, int& offsetMinutes);
+
+/// Zone of filename and EXIF wall-clock times (--tz; default fixed UTC+8).
+/// Set once at startup, before any file is processed.
+void setLocalTimeZone(std::shared_ptr<const TimeZone> zone);
+const TimeZone& localTimeZone();
+
+}  // namespace filetimefixer
@@ -1,9 +1,12 @@
 #include "VideoMetaHelper.h"
+#include "IoBudget.h"
+#include "TimeConvert.h"
 #include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <cstring>
+#include <ctime>
 #include <filesystem>
 #ifdef _WIN32
 #include <windows.h>
@@ -18,6 +21,8 @@ namespace filetimefixer {
 
 namespace {
 
+const std::string kTempSuffix = "_ftf_tmp";
+
 /// Run a command and return stdout as string. Returns empty on failure or if command not found.
 std::string runCommand(const std::string& command) {
 #ifdef _WIN32
@@ -61,25 +66,42 @@ std::string normalizeCreationTime(const std::string& s) {
     return t;
 }
 
+/// Read creation_time with ffprobe. Every probe (the first read and the read-back after a fix) goes through
+/// here, so each one is charged against the I/O budget like an EXIF header read.
+std::string probeCreationTime(const std::string& filePath) {
+    chargeMetadataOps();
+    chargeReadBytes(headerReadBytes(filePath));
+    std::string cmd = "ffprobe -v error -show_entries format_tags=creation_time -of default=noprint_wrappers=1:nokey=1 " + quotePath(filePath);
+    return normalizeCreationTime(runCommand(cmd));
+}
+
 }  // namespace
 
 std::string getVideoCreationTimeUtc(const std::string& filePath) {
     if (filePath.empty()) return "";
-    std::string qpath = quotePath(filePath);
-    std::string cmd = "ffprobe -v error -show_entries format_tags=creation_time -of default=noprint_wrappers=1:nokey=1 " + qpath;
-    std::string out = runCommand(cmd);
-    return normalizeCreationTime(out);
+    return probeCreationTime(filePath);
 }
 
-bool setVideoCreationTime(const std::string& filePath, const std::string& targetTimeUtc) {
-    if (filePath.empty() || targetTimeUtc.size() < 19) return false;
-    std::string timeForFfmpeg = targetTimeUtc.substr(0, 19);
-    if (timeForFfmpeg[10] == ' ') timeForFfmpeg[10] = 'T';
+bool isVideoTempFile(const fs::path& path) {
+    std::string stem = path.stem().string();
+    return stem.size() >= kTempSuffix.size()
+        && stem.compare(stem.size() - kTempSuffix.size(), kTempSuffix.size(), kTempSuffix) == 0;
+}
+
+bool setVideoCreationTime(const std::string& filePath, const TimeValue& targetTime) {
+    if (filePath.empty() || targetTime.empty()) return false;
+    std::string timeForFfmpeg = timestampToUTCString(static_cast<std::time_t>(targetTime.epochSeconds()));
     fs::path p(filePath);
     if (!fs::exists(p) || !fs::is_regular_file(p)) return false;
 
+    // ffmpeg copies every stream into the temp file, which then replaces the original
+    uint64_t fileSize = fileSizeForBudget(filePath);
+    chargeReadBytes(fileSize);
+    chargeWriteBytes(fileSize);
+    chargeMetadataOps(2);
+
     fs::path dir = p.parent_path();
-    fs::path tempPath = dir / (p.stem().string() + "_ftf_tmp" + p.extension().string());
+    fs::path tempPath = dir / (p.stem().string() + kTempSuffix + p.extension().string());
 
     std::string qpath = quotePath(filePath);
     std::string qtemp = quotePath(tempPath.string());
@@ -106,7 +128,8 @@ bool setVideoCreationTime(const std::string& filePath, const std::string& target
 }
 
 std::string getVideoTimeInfoString(const std::string& filePath) {
-    std::string ct = getVideoCreationTimeUtc(filePath);
+    if (filePath.empty()) return "(no video metadata)";
+    std::string ct = probeCreationTime(filePath);
     if (ct.empty()) return "(no video metadata)";
     return "creation_time=" + ct;
 }
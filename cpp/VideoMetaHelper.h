@@ -1,5 +1,7 @@
 #pragma once
 
+#include "TimeValue.h"
+#include <filesystem>
 #include <string>
 
 namespace filetimefixer {
@@ -7,10 +9,14 @@ namespace filetimefixer {
 /// Get QuickTime/MP4 creation_time from video file (via ffprobe). Returns UTC string "YYYY-MM-DDTHH:MM:SS" or empty.
 std::string getVideoCreationTimeUtc(const std::string& filePath);
 
-/// Set creation_time in video file (via ffmpeg). Returns true on success. Requires ffmpeg on PATH.
-bool setVideoCreationTime(const std::string& filePath, const std::string& targetTimeUtc);
+/// Set creation_time in video file (via ffmpeg) to targetTime in UTC. Returns true on success. Requires ffmpeg on PATH.
+bool setVideoCreationTime(const std::string& filePath, const TimeValue& targetTime);
 
 /// Get a short string describing video time metadata for logging (e.g. "creation_time=2023-10-23T12:00:00" or "(no video metadata)").
+/// Runs ffprobe, charged against the I/O budget like getVideoCreationTimeUtc.
 std::string getVideoTimeInfoString(const std::string& filePath);
 
+/// True for the intermediate file setVideoCreationTime writes next to the video ("<stem>_ftf_tmp<ext>").
+bool isVideoTempFile(const std::filesystem::path& path);
+
 }  // namespace filetimefixer
@@ -0,0 +1,104 @@
+#include "WorkerPool.h"
+#include <exception>
+#include <iostream>
+
+namespace filetimefixer {
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount, size_t capacity) {
+    if (threadCount == 0) threadCount = 1;
+    capacity_ = capacity == 0 ? static_cast<size_t>(threadCount) * 64 : capacity;
+    for (unsigned i = 0; i < threadCount; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        threads_.emplace_back(&WorkStealingPool::workerLoop, this, static_cast<size_t>(i));
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lk(stateMutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t target;
+    {
+        std::unique_lock<std::mutex> lk(stateMutex_);
+        spaceCv_.wait(lk, [this] { return queued_ < capacity_; });
+        target = nextQueue_++ % queues_.size();
+        ++pending_;
+        ++queued_;
+    }
+    {
+        std::lock_guard<std::mutex> lk(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    workCv_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lk(stateMutex_);
+    doneCv_.wait(lk, [this] { return pending_ == 0; });
+}
+
+size_t WorkStealingPool::failedTaskCount() const {
+    std::lock_guard<std::mutex> lk(stateMutex_);
+    return failed_;
+}
+
+bool WorkStealingPool::tryPop(size_t self, std::function<void()>& task) {
+    const size_t n = queues_.size();
+    for (size_t k = 0; k < n; ++k) {
+        Queue& q = *queues_[(self + k) % n];
+        std::lock_guard<std::mutex> lk(q.mutex);
+        if (q.tasks.empty()) continue;
+        if (k == 0) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        } else {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t self) {
+    for (;;) {
+        std::function<void()> task;
+        if (tryPop(self, task)) {
+            {
+                std::lock_guard<std::mutex> lk(stateMutex_);
+                --queued_;
+            }
+            spaceCv_.notify_one();
+            bool ok = false;
+            try {
+                task();
+                ok = true;
+            } catch (const std::exception& e) {
+                std::cerr << "[Error] Worker task failed: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "[Error] Worker task failed with an unknown exception" << std::endl;
+            }
+            std::lock_guard<std::mutex> lk(stateMutex_);
+            if (!ok) ++failed_;
+            if (--pending_ == 0) doneCv_.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(stateMutex_);
+        workCv_.wait(lk, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0) return;
+    }
+}
+
+unsigned defaultJobCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+}  // namespace filetimefixer
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace filetimefixer {
+
+/// Fixed-size work-stealing thread pool. Each worker owns a deque: it takes tasks from the
+/// front of its own queue and, when that is empty, steals from the back of another worker's.
+/// At most `capacity` tasks wait in the queues; submit() blocks while they are full
+/// (backpressure), so a traversal of millions of files does not queue them all up front.
+/// A pool built with kUnbounded never blocks submit().
+/// Tasks should report their own errors: an exception escaping a task is logged to stderr and
+/// counted in failedTaskCount() as a last resort.
+class WorkStealingPool {
+public:
+    /// No limit on waiting tasks
+    static constexpr size_t kUnbounded = static_cast<size_t>(-1);
+
+    /// capacity 0: 64 waiting tasks per thread
+    explicit WorkStealingPool(unsigned threadCount, size_t capacity = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    /// Block until every submitted task has finished.
+    void wait();
+
+    unsigned threadCount() const { return static_cast<unsigned>(threads_.size()); }
+    /// Tasks that ended with an exception
+    size_t failedTaskCount() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool tryPop(size_t self, std::function<void()>& task);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    mutable std::mutex stateMutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    std::condition_variable spaceCv_;
+    size_t capacity_;
+    size_t queued_ = 0;   // tasks sitting in some queue
+    size_t pending_ = 0;  // tasks submitted but not yet finished
+    size_t nextQueue_ = 0;
+    size_t failed_ = 0;
+    bool stopping_ = false;
+};
+
+/// Number of worker threads to use for "--jobs 0" (auto): hardware concurrency, at least 1.
+unsigned defaultJobCount();
+
+}  // namespace filetimefixer